@@ -0,0 +1,99 @@
+#include "Auction.h"
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Auction.cpp - the equilibrium price search and the prefix sums behind it
+// see Auction.h for the rules. OrderBook.cpp does the phase switching and the executing
+
+void prefix_sum_scalar(int64_t* data, size_t n) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += data[i];
+        data[i] = sum;
+    }
+}
+
+#ifdef __AVX2__
+// four lanes [a b c d] -> [a a+b a+b+c a+b+c+d] with two shift-and-adds, then add the running
+// total carried over from the previous four. the loop-carried dependency is one add per four
+// values instead of one per value, which is where the scalar loop spends its time
+void prefix_sum(int64_t* data, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i carry = zero;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        // shift up one lane ([0 a b c]) - permute then zero lane 0
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+        // shift up two lanes ([0 0 a a+b]) - low half to the high half, zero the low half
+        x = _mm256_add_epi64(x, _mm256_permute2x128_si256(x, x, 0x08));
+        x = _mm256_add_epi64(x, carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), x);
+        carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3)); // broadcast the last lane
+    }
+    int64_t sum = i > 0 ? data[i - 1] : 0;
+    for (; i < n; ++i) {
+        sum += data[i];
+        data[i] = sum;
+    }
+}
+#else
+void prefix_sum(int64_t* data, size_t n) {
+    prefix_sum_scalar(data, n);
+}
+#endif
+
+AuctionResult AuctionSolver::solve(const PriceLadder& bids, const PriceLadder& asks, int32_t reference_price) {
+    AuctionResult result;
+    if (bids.empty() || asks.empty()) return result;
+    const int32_t lo = asks.lowest();
+    const int32_t hi = bids.highest();
+    if (hi < lo) return result; // not crossed - nothing executes at any price
+
+    // lay the crossed range out flat. bids below lo and asks above hi can't execute anywhere
+    // in it, so they're left out. iceberg reserve is in: it executes at its price once the
+    // slice in front of it has
+    const size_t n = static_cast<size_t>(hi - lo) + 1;
+    bid_.assign(n + 1, 0);
+    ask_.assign(n, 0);
+    for (int32_t p = hi; p != PriceLadder::npos && p >= lo; p = bids.next_lower(p)) {
+        bid_[static_cast<size_t>(p - lo) + 1] = static_cast<int64_t>(bids.tradable_qty(p));
+    }
+    for (int32_t p = lo; p != PriceLadder::npos && p <= hi; p = asks.next_higher(p)) {
+        ask_[static_cast<size_t>(p - lo)] = static_cast<int64_t>(asks.tradable_qty(p));
+    }
+    prefix_sum(bid_.data(), n + 1);
+    prefix_sum(ask_.data(), n);
+
+    // bids at or above lo + i = every bid in range minus the ones below it
+    const int64_t total_bid = bid_[n];
+    int64_t best_volume = -1;
+    int64_t best_imbalance = 0;
+    int64_t best_distance = 0;
+    size_t best = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const int64_t buy = total_bid - bid_[i];
+        const int64_t sell = ask_[i];
+        const int64_t volume = std::min(buy, sell);
+        if (volume < best_volume) continue;
+        const int64_t imbalance = std::abs(buy - sell);
+        const int64_t distance = reference_price != 0 ? std::abs(static_cast<int64_t>(lo) + static_cast<int64_t>(i) - reference_price) : 0;
+        // ties on everything keep the earlier (lower) price
+        if (volume > best_volume || imbalance < best_imbalance ||
+            (imbalance == best_imbalance && distance < best_distance)) {
+            best_volume = volume;
+            best_imbalance = imbalance;
+            best_distance = distance;
+            best = i;
+        }
+    }
+
+    result.price = lo + static_cast<int32_t>(best);
+    result.volume = static_cast<uint64_t>(best_volume);
+    result.imbalance = (total_bid - bid_[best]) - ask_[best];
+    return result;
+}
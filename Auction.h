@@ -0,0 +1,53 @@
+#pragma once
+
+// Auction.h - call auctions (open / close): orders pile up without matching, then all execute at one price
+// OrderBook::start_auction() switches the book into the call phase - limit orders rest even if
+// they cross, so the book can be crossed. OrderBook::uncross() works out the equilibrium price and
+// executes everything that crosses at it, then goes back to continuous matching.
+//
+// the equilibrium price is the one that, in order:
+//   1. executes the most volume - min(bids at or above it, asks at or below it)
+//   2. leaves the smallest imbalance - |bids at or above - asks at or below|
+//   3. is closest to the reference price (the previous close, say - 0 skips this one)
+//   4. is the lowest, so there's always exactly one answer
+// volumes count iceberg reserve as well as displayed quantity, so uncross is one round at one
+// price - the reserve it takes is already in `volume`.
+// only ticks between the lowest ask and the highest bid can execute anything, so the solver lays
+// that range out as two flat arrays of level quantity and turns them into the cumulative curves
+// with a prefix sum each - one pass over the occupied levels to fill them, a SIMD scan, and one
+// pass to pick the price. nothing walks individual orders
+
+#include "PriceLadder.h"
+#include "Trade.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct AuctionResult {
+    int32_t  price = 0;     // equilibrium price in ticks, 0 if nothing crosses
+    uint64_t volume = 0;    // quantity that executes at it
+    int64_t  imbalance = 0; // bids at or above - asks at or below, at that price (positive = buyers left over)
+
+    // uncross() only - every trade it made (all at `price`) and the stops they set off. same
+    // lifetime rules as ProcessOrderResult::trades
+    std::span<const Trade> trades;
+    uint32_t stops_triggered = 0;
+};
+
+class AuctionSolver {
+public:
+    // the equilibrium for the book as it stands - trades and stops_triggered are left empty
+    AuctionResult solve(const PriceLadder& bids, const PriceLadder& asks, int32_t reference_price);
+
+private:
+    // one slot per tick from the lowest ask to the highest bid. reused, so after the first call
+    // the solver only allocates if the crossed range gets wider than it's been before
+    std::vector<int64_t> bid_; // bid_[i]: bids at prices below lowest ask + i (exclusive prefix, one longer)
+    std::vector<int64_t> ask_; // ask_[i]: asks at prices up to lowest ask + i (inclusive prefix)
+};
+
+// in-place inclusive prefix sum. AVX2 four lanes at a time when the build targets it
+// (ORDERBOOK_NATIVE on a machine that has it), a plain loop otherwise - same answer either way
+void prefix_sum(int64_t* data, size_t n);
+void prefix_sum_scalar(int64_t* data, size_t n);
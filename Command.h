@@ -0,0 +1,116 @@
+#pragma once
+
+// Command.h - the message that gets handed to a matcher thread
+// a gateway thread doesn't call process_order / cancel_order directly - it packs up one of these
+// and pushes it through an SpscRing, and the thread that owns the book applies it.
+// what comes back out the other side is in Event.h.
+// kept small and flat (32 bytes, no pointers) so it copies cheaply through the ring.
+
+#include "Order.h"
+#include <cstdint>
+
+enum class CommandType : uint8_t {
+    New          = 0, // process_order
+    Cancel       = 1, // cancel_order
+    Modify       = 2, // change price / quantity of a resting order
+    Stop         = 3, // place_stop - a New that waits for trigger_price to trade first
+    Iceberg      = 4, // process_iceberg - a New limit that shows display_quantity at a time
+    AuctionStart = 5, // start_auction - answered with status Pending
+    Uncross      = 6, // uncross(price) - price is the reference price. answered with its trades, status Filled
+    Clock        = 7, // advance_time(now). answered with status Expired
+    MassCancel   = 8  // mass_cancel - which one is mass.scope. answered with status Cancelled
+};
+
+// which mass_cancel a MassCancel command is
+enum class MassCancelScope : uint8_t {
+    Owner      = 0, // everything `owner` has
+    OwnerSide  = 1, // what `owner` has on `side`
+    PriceRange = 2  // everything on `side` at prices [price, mass.price_high], whoever owns it
+};
+
+struct Command {
+    CommandType type;
+    OrderSide   side;       // New, Stop, Iceberg, MassCancel (OwnerSide / PriceRange)
+    OrderType   order_type; // New, Stop (what it goes in as when it fires)
+    TimeInForce tif;        // New - GTT / Day go through process_order(order, tif, expire_time)
+    uint32_t    symbol;     // which book - used by MatchingEngine to pick the shard
+    int32_t     price;      // New, Stop, Iceberg, Modify (new price), Uncross (reference),
+                            // MassCancel (bottom of the range) - in ticks
+    uint32_t    owner;      // New, Stop, Iceberg - who it belongs to (0 = nobody). MassCancel - whose
+    uint64_t    quantity;   // New, Stop, Modify (new quantity), Iceberg (total)
+    union {                 // one 8-byte slot, each command type reads the one named for it
+        uint64_t order_id;         // Cancel, Modify - the ID process_order handed back
+        uint64_t expire_time;      // New - a GTT's, in the book's clock units (a new order has no ID yet)
+        uint64_t now;              // Clock - what to advance the book's clock to
+        int32_t  trigger_price;    // Stop
+        uint32_t display_quantity; // Iceberg - slices are capped at 32 bits even with wide quantities
+        struct {
+            int32_t         price_high; // PriceRange - the top of it
+            MassCancelScope scope;
+        } mass;                    // MassCancel
+    };
+
+    // quantity is wider than Order's (Quantity is 32 bits unless ORDERBOOK_WIDE_QUANTITY), so a
+    // New / Stop / Iceberg over MAX_QUANTITY has to be answered Rejected before it becomes an
+    // Order - converting it would truncate it and rest the wrong size. Modify is checked by
+    // modify_order itself
+    bool oversized() const {
+        return quantity > MAX_QUANTITY &&
+               (type == CommandType::New || type == CommandType::Stop || type == CommandType::Iceberg);
+    }
+
+    static Command new_order(uint32_t symbol, const Order& o) {
+        return {CommandType::New, o.side, o.type, TimeInForce::GTC, symbol, o.price, 0, o.quantity, 0};
+    }
+    static Command new_order(uint32_t symbol, const Order& o, TimeInForce tif, uint64_t expire_time = 0,
+                             uint32_t owner = 0) {
+        Command c{CommandType::New, o.side, o.type, tif, symbol, o.price, owner, o.quantity, 0};
+        c.expire_time = expire_time;
+        return c;
+    }
+    static Command cancel(uint32_t symbol, uint64_t order_id) {
+        return {CommandType::Cancel, OrderSide::Buy, OrderType::Limit, TimeInForce::GTC, symbol, 0, 0, 0, order_id};
+    }
+    static Command modify(uint32_t symbol, uint64_t order_id, int32_t new_price, uint64_t new_quantity) {
+        return {CommandType::Modify, OrderSide::Buy, OrderType::Limit, TimeInForce::GTC, symbol, new_price, 0, new_quantity, order_id};
+    }
+    static Command stop(uint32_t symbol, const Order& o, int32_t trigger_price, uint32_t owner = 0) {
+        Command c{CommandType::Stop, o.side, o.type, TimeInForce::GTC, symbol, o.price, owner, o.quantity, 0};
+        c.trigger_price = trigger_price;
+        return c;
+    }
+    static Command start_auction(uint32_t symbol) {
+        return {CommandType::AuctionStart, OrderSide::Buy, OrderType::Limit, TimeInForce::GTC, symbol, 0, 0, 0, 0};
+    }
+    static Command uncross(uint32_t symbol, int32_t reference_price) {
+        return {CommandType::Uncross, OrderSide::Buy, OrderType::Limit, TimeInForce::GTC, symbol, reference_price, 0, 0, 0};
+    }
+    static Command clock(uint32_t symbol, uint64_t now) {
+        Command c{CommandType::Clock, OrderSide::Buy, OrderType::Limit, TimeInForce::GTC, symbol, 0, 0, 0, 0};
+        c.now = now;
+        return c;
+    }
+    static Command mass_cancel(uint32_t symbol, uint32_t owner) {
+        Command c{CommandType::MassCancel, OrderSide::Buy, OrderType::Limit, TimeInForce::GTC, symbol, 0, owner, 0, 0};
+        c.mass.scope = MassCancelScope::Owner;
+        return c;
+    }
+    static Command mass_cancel(uint32_t symbol, uint32_t owner, OrderSide side) {
+        Command c{CommandType::MassCancel, side, OrderType::Limit, TimeInForce::GTC, symbol, 0, owner, 0, 0};
+        c.mass.scope = MassCancelScope::OwnerSide;
+        return c;
+    }
+    static Command mass_cancel(uint32_t symbol, OrderSide side, int32_t low, int32_t high) {
+        Command c{CommandType::MassCancel, side, OrderType::Limit, TimeInForce::GTC, symbol, low, 0, 0, 0};
+        c.mass.price_high = high;
+        c.mass.scope = MassCancelScope::PriceRange;
+        return c;
+    }
+    static Command iceberg(uint32_t symbol, const Order& o, uint32_t display_quantity, uint32_t owner = 0) {
+        Command c{CommandType::Iceberg, o.side, OrderType::Iceberg, TimeInForce::GTC, symbol, o.price, owner, o.quantity, 0};
+        c.display_quantity = display_quantity;
+        return c;
+    }
+};
+
+static_assert(sizeof(Command) == 32, "Command layout changed");
@@ -0,0 +1,29 @@
+#pragma once
+
+// Event.h - what a matcher thread sends back out after applying a Command (see Command.h)
+// every command produces zero or more Trade events followed by exactly one Status event, all
+// tagged with the command's sequence number, so whoever's reading the egress ring can line
+// them back up with what it sent without the matcher keeping any per-client state.
+
+#include "Command.h"
+#include "OrderBook.h"
+#include <cstdint>
+
+enum class EventType : uint8_t {
+    Trade     = 0, // one fill - buyer / seller / price / quantity
+    Status    = 1, // the final outcome of a command - always the last event for that command
+    Expired   = 2, // Clock: one per GTT / Day order it took out (order_id), before its Status
+    Cancelled = 3  // MassCancel: one per order it took out (order_id), before its Status
+};
+
+struct Event {
+    EventType   type;
+    CommandType command;  // Status: which kind of command this answers
+    OrderStatus status;   // Status only
+    int32_t     price;    // Trade only, in ticks
+    uint64_t    seq;      // sequence number of the command this came from (0, 1, 2 ... in arrival order)
+    uint64_t    order_id; // Trade: buyer order ID. Status: New - the order's ID (0 if it didn't rest),
+                          // Cancel / Modify - the order it was for
+    uint64_t    other_id; // Trade: seller order ID
+    uint64_t    quantity; // Trade only
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+// FenwickTree.h - binary indexed tree over per-tick quantities
+// PriceLadder keeps one of these (optionally) so "how much is resting up to price P" and
+// "how far does a sweep of Q go" are O(log N) instead of walking level by level.
+// values are unsigned but deltas can be negative - the arithmetic wraps, and since every
+// real prefix sum is >= 0 the wrapped intermediate values always come back out right.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FenwickTree {
+public:
+    FenwickTree() = default;
+    explicit FenwickTree(size_t n) : tree_(n + 1, 0) {
+        top_bit_ = 1;
+        while (top_bit_ * 2 <= n) top_bit_ *= 2;
+    }
+
+    size_t size() const { return tree_.empty() ? 0 : tree_.size() - 1; }
+
+    // slot i += delta
+    void add(size_t i, int64_t delta) {
+        for (size_t k = i + 1; k < tree_.size(); k += k & (~k + 1)) {
+            tree_[k] += static_cast<uint64_t>(delta);
+        }
+    }
+
+    // sum of slots [0, i]
+    uint64_t prefix(size_t i) const {
+        uint64_t sum = 0;
+        for (size_t k = i + 1; k > 0; k -= k & (~k + 1)) sum += tree_[k];
+        return sum;
+    }
+
+    // the largest count c such that slots [0, c) sum to <= limit - i.e. slot c is the one that
+    // pushes the running total past limit (c == size() if nothing does). one pass down the tree
+    size_t count_within(uint64_t limit) const {
+        size_t pos = 0;
+        for (size_t step = top_bit_; step > 0; step >>= 1) {
+            size_t next = pos + step;
+            if (next < tree_.size() && tree_[next] <= limit) {
+                pos = next;
+                limit -= tree_[next];
+            }
+        }
+        return pos;
+    }
+
+    // O(n) rebuild from the raw per-slot values - used after the ladder re-centres
+    void build(const std::vector<uint64_t>& values) {
+        tree_.assign(values.size() + 1, 0);
+        top_bit_ = 1;
+        while (top_bit_ * 2 <= values.size()) top_bit_ *= 2;
+        for (size_t i = 0; i < values.size(); ++i) {
+            size_t k = i + 1;
+            tree_[k] += values[i];
+            size_t parent = k + (k & (~k + 1));
+            if (parent < tree_.size()) tree_[parent] += tree_[k];
+        }
+    }
+
+private:
+    std::vector<uint64_t> tree_; // 1-based, tree_[0] unused
+    size_t top_bit_ = 0;         // highest power of two <= size(), where count_within starts
+};
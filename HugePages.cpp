@@ -0,0 +1,34 @@
+#include "HugePages.h"
+#include <new>
+#include <sys/mman.h>
+
+// HugePages.cpp - mmap wrappers, see HugePages.h
+
+static constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+static size_t round_up(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+Chunk map_chunk(size_t bytes, HugePages mode) {
+    if (mode == HugePages::Explicit) {
+        size_t len = round_up(bytes, HUGE_PAGE);
+        void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) return {p, len};
+        // no hugetlbfs pages reserved - fall through and let THP do what it can
+    }
+
+    size_t len = round_up(bytes, 4096);
+    void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+    if (mode != HugePages::None) ::madvise(p, len, MADV_HUGEPAGE);
+#endif
+    return {p, len};
+}
+
+void unmap_chunk(const Chunk& chunk) {
+    if (chunk.ptr) ::munmap(chunk.ptr, chunk.bytes);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// HugePages.h - big anonymous allocations with optional huge page backing
+// OrderPool chunks and OrderIdMap pages are a few MB each and get hit randomly by order ID /
+// pool slot, which is exactly the access pattern that thrashes the TLB with 4 KB pages.
+// backing them with 2 MB pages means one TLB entry covers a whole chunk.
+
+#include <cstddef>
+#include <cstdint>
+
+enum class HugePages : uint8_t {
+    None        = 0, // plain 4 KB pages
+    Transparent = 1, // ask the kernel for transparent huge pages (madvise) - best effort, no setup
+    Explicit    = 2  // MAP_HUGETLB from the reserved hugetlbfs pool - needs vm.nr_hugepages set,
+                     // falls back to Transparent if the pool is empty
+};
+
+// a mapping handed out by map_chunk - keep it to give back to unmap_chunk
+struct Chunk {
+    void*  ptr   = nullptr;
+    size_t bytes = 0; // actual mapped size (rounded up to the page size that was used)
+};
+
+// zero-filled, throws std::bad_alloc if the kernel won't give us the memory
+Chunk map_chunk(size_t bytes, HugePages mode);
+void  unmap_chunk(const Chunk& chunk);
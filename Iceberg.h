@@ -0,0 +1,58 @@
+#pragma once
+
+// Iceberg.h - iceberg orders: a big limit order that only shows a slice of itself at a time
+// the book only ever shows the slice - it's an ordinary Order in its price level's fifo, and
+// depth / market data / the top of book count just its displayed quantity. the rest sits in
+// `hidden`, and PriceLadder keeps a per-level sum of it so the FOK dry run and the risk queries
+// can count what would really trade. when the slice fills, OrderBook::match_and_fill tops it back up to `display` from
+// hidden and moves it to the back of the same level - a pop_front and a push_back, the order
+// doesn't leave the level, go back to a pool or touch the lookup map, and it keeps its ID.
+//
+// Order is 32 bytes with no room left, so the extra two fields can't go in it. instead an iceberg
+// lives in an IcebergOrder slot (the Order first, then its reserve) instead of an OrderPool slot,
+// and the refill gets from the Order* it already has to the reserve with a cast - no lookup.
+// the same trick StopBook uses for StopOrder
+
+#include "Order.h"
+#include <cstddef>
+#include <deque>
+#include <type_traits>
+
+struct IcebergOrder {
+    Order     order;   // the displayed slice - order.quantity is what's showing right now
+    Quantity  display; // how much to show at a time
+    Quantity  hidden;  // still to come once the slice is gone
+    OrderCold cold;    // what OrderPool keeps in its cold array - icebergs are few, so it rides along
+};
+
+static_assert(std::is_standard_layout_v<IcebergOrder>, "IcebergOrder must stay standard-layout");
+
+// only valid for an order whose type is OrderType::Iceberg
+inline IcebergOrder* as_iceberg(Order* o) { return reinterpret_cast<IcebergOrder*>(o); }
+inline const IcebergOrder* as_iceberg(const Order* o) { return reinterpret_cast<const IcebergOrder*>(o); }
+
+// slots for resting icebergs - same idea as OrderPool, smaller scale. slots never move once made
+// (a deque only adds blocks), freed ones are threaded through order.next and reused first
+class IcebergPool {
+public:
+    IcebergOrder* get_order() {
+        ++in_use_;
+        if (free_ == nullptr) return &slots_.emplace_back();
+        IcebergOrder* ice = as_iceberg(free_);
+        free_ = free_->next;
+        return ice;
+    }
+
+    void return_order(IcebergOrder* ice) {
+        ice->order.next = free_;
+        free_ = &ice->order;
+        --in_use_;
+    }
+
+    size_t in_use() const { return in_use_; }
+
+private:
+    std::deque<IcebergOrder> slots_;
+    Order* free_ = nullptr;
+    size_t in_use_ = 0;
+};
@@ -0,0 +1,247 @@
+#include "Journal.h"
+#include "MappedFile.h"
+#include "OrderBook.h"
+#include "WaitStrategy.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Journal.cpp - journal file handling, the group-commit flusher and replay
+// see Journal.h for the format and the durability rules
+
+static constexpr uint64_t GROW_RECORDS = (64 * 1024 * 1024) / sizeof(JournalRecord); // 64 MB steps
+static constexpr size_t   PAGE_BYTES   = 4096;
+static constexpr uint64_t PREFAULT_RECORDS = (1024 * 1024) / sizeof(JournalRecord); // 1 MB ahead
+
+static size_t record_offset(uint64_t index) {
+    return sizeof(JournalHeader) + index * sizeof(JournalRecord);
+}
+
+Journal::Journal(const JournalConfig& config) : config_(config) {
+    fd_ = ::open(config_.path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Could not open journal " + config_.path + "!");
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Could not stat journal " + config_.path + "!");
+    }
+
+    void* p = ::mmap(nullptr, config_.max_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("Could not mmap journal " + config_.path + "!");
+    }
+    map_ = static_cast<uint8_t*>(p);
+    records_ = reinterpret_cast<JournalRecord*>(map_ + sizeof(JournalHeader));
+
+    JournalHeader* header = reinterpret_cast<JournalHeader*>(map_);
+    const size_t existing = static_cast<size_t>(st.st_size);
+    uint64_t n = 0;
+    if (existing == 0) {
+        if (!grow_to(GROW_RECORDS)) {
+            ::munmap(map_, config_.max_bytes);
+            ::close(fd_);
+            throw std::runtime_error("Could not size journal " + config_.path + "!");
+        }
+        std::memcpy(header->magic, "OBJRNL01", 8);
+        header->record_size = sizeof(JournalRecord);
+    } else {
+        if (existing < sizeof(JournalHeader) || std::memcmp(header->magic, "OBJRNL01", 8) != 0 ||
+            header->record_size != sizeof(JournalRecord)) {
+            ::munmap(map_, config_.max_bytes);
+            ::close(fd_);
+            throw std::runtime_error(config_.path + " is not a journal!");
+        }
+        // carry on after the last whole record - anything torn past it gets overwritten
+        const uint64_t fits = (existing - sizeof(JournalHeader)) / sizeof(JournalRecord);
+        file_records_.store(fits, std::memory_order_relaxed);
+        while (n < fits && records_[n].type != JournalRecordType::End && records_[n].seq == n + 1) ++n;
+        if (!grow_to(n + GROW_RECORDS)) {
+            ::munmap(map_, config_.max_bytes);
+            ::close(fd_);
+            throw std::runtime_error("Could not size journal " + config_.path + "!");
+        }
+        // zero whatever's past the last good record (a torn tail) so the end marker is right again
+        // and nothing stale after it can look like a valid record later
+        if (fits > n) std::memset(&records_[n], 0, (fits - n) * sizeof(JournalRecord));
+    }
+    count_.store(n, std::memory_order_relaxed);
+    durable_.store(n, std::memory_order_relaxed);
+    capacity_ = file_records_.load(std::memory_order_relaxed);
+
+    flusher_ = std::thread([this] { flush_loop(); });
+}
+
+Journal::~Journal() {
+    stop_.store(true, std::memory_order_release);
+    flusher_.join();
+    flush_once();
+
+    // trim the zeroed growth slack - reopening starts appending straight after the last record
+    const size_t used = record_offset(count_.load(std::memory_order_relaxed));
+    ::munmap(map_, config_.max_bytes);
+    if (::ftruncate(fd_, static_cast<off_t>(used)) == 0) ::fdatasync(fd_);
+    ::close(fd_);
+}
+
+void Journal::sync() const {
+    const uint64_t target = count_.load(std::memory_order_relaxed);
+    IdleWaiter waiter(WaitStrategy::Backoff);
+    while (durable_.load(std::memory_order_acquire) < target) waiter.idle();
+}
+
+bool Journal::grow_to(uint64_t records) {
+    std::lock_guard<std::mutex> lock(grow_mutex_);
+    if (records <= file_records_.load(std::memory_order_relaxed)) return true;
+    const size_t bytes = record_offset(records);
+    if (bytes > config_.max_bytes) return false;
+    // file only ever grows, so two callers racing here can't shrink it under the writer
+    if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) return false;
+    file_records_.store(records, std::memory_order_release);
+    return true;
+}
+
+void Journal::grow_for_writer() {
+    // the flusher didn't get round to extending the file in time - do it here (an ftruncate, not a
+    // sync, so it's still cheap). if there's no room at all, refuse the input rather than lose it
+    capacity_ = file_records_.load(std::memory_order_acquire);
+    if (count_.load(std::memory_order_relaxed) < capacity_) return;
+    if (!grow_to(capacity_ + GROW_RECORDS)) {
+        throw std::runtime_error("Journal full!");
+    }
+    capacity_ = file_records_.load(std::memory_order_acquire);
+}
+
+void Journal::flush_loop() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(config_.flush_interval_us));
+        flush_once();
+
+        // keep at least half a growth step of file ahead of the writer
+        const uint64_t written = count_.load(std::memory_order_acquire);
+        const uint64_t fits = file_records_.load(std::memory_order_acquire);
+        if (fits - written < GROW_RECORDS / 2) grow_to(fits + GROW_RECORDS);
+        prefault(written);
+    }
+}
+
+void Journal::prefault(uint64_t written) {
+#ifdef MADV_POPULATE_WRITE
+    // map the next stretch of file pages in before the writer gets there, so the matching thread
+    // doesn't take a page fault every 128 records. doesn't change the contents
+    const uint64_t target = std::min(written + PREFAULT_RECORDS,
+                                     file_records_.load(std::memory_order_acquire));
+    if (prefaulted_ < written) prefaulted_ = written;
+    if (target <= prefaulted_) return;
+    size_t from = record_offset(prefaulted_) / PAGE_BYTES * PAGE_BYTES;
+    size_t to = record_offset(target) / PAGE_BYTES * PAGE_BYTES;
+    if (to > from) ::madvise(map_ + from, to - from, MADV_POPULATE_WRITE);
+    prefaulted_ = target;
+#else
+    (void)written;
+#endif
+}
+
+void Journal::flush_once() {
+    const uint64_t durable = durable_.load(std::memory_order_relaxed);
+    const uint64_t written = count_.load(std::memory_order_acquire);
+    if (written == durable) return;
+
+    // one msync covers every record written since the last pass - that's the group commit
+    size_t from = record_offset(durable) / PAGE_BYTES * PAGE_BYTES;
+    size_t to = record_offset(written);
+    ::msync(map_ + from, to - from, MS_SYNC);
+    durable_.store(written, std::memory_order_release);
+}
+
+ReplayStats replay_journal(const std::string& path, OrderBook& book, uint64_t from_seq) {
+    MappedFile file(path);
+    const JournalHeader* header = reinterpret_cast<const JournalHeader*>(file.data());
+    if (file.size() < sizeof(JournalHeader) || std::memcmp(header->magic, "OBJRNL01", 8) != 0 ||
+        header->record_size != sizeof(JournalRecord)) {
+        throw std::runtime_error(path + " is not a journal!");
+    }
+
+    const JournalRecord* records = reinterpret_cast<const JournalRecord*>(file.data() + sizeof(JournalHeader));
+    const uint64_t fits = (file.size() - sizeof(JournalHeader)) / sizeof(JournalRecord);
+
+    ReplayStats stats;
+    uint64_t expire_time = 0; // from an Expiry record, for the New that follows it
+    uint32_t owner = 0;       // from an Owner record, for the New / Iceberg / Stop that follows it
+    for (uint64_t i = from_seq > 0 ? from_seq - 1 : 0; i < fits; ++i) {
+        const JournalRecord& r = records[i];
+        if (r.type == JournalRecordType::End) break;
+        if (r.seq != i + 1) {
+            throw std::runtime_error("Journal out of sequence!");
+        }
+        ++stats.records;
+
+        // a journal written by an ORDERBOOK_WIDE_QUANTITY build can hold quantities this build's
+        // Order can't - refused rather than truncated (the IDs after it will then mismatch too)
+        if (r.quantity > MAX_QUANTITY && (r.type == JournalRecordType::New || r.type == JournalRecordType::Stop ||
+                                          r.type == JournalRecordType::Iceberg)) {
+            ++stats.oversized;
+            expire_time = 0;
+            owner = 0;
+            continue;
+        }
+
+        if (r.type == JournalRecordType::New) {
+            ++stats.new_orders;
+            // a Day order went in with the close it was given at the time, so it replays as GTT to that
+            Order order(r.side, r.order_type, r.price, r.quantity);
+            auto result = expire_time || owner ? book.process_order(order, expire_time ? TimeInForce::GTT : TimeInForce::GTC,
+                                                                    expire_time, owner)
+                                               : book.process_order(order);
+            expire_time = 0;
+            owner = 0;
+            stats.trades += result.trades.size();
+            if (result.new_order_id != 0 && result.new_order_id != r.order_id) ++stats.id_mismatches;
+        } else if (r.type == JournalRecordType::Expiry) {
+            expire_time = r.order_id;
+        } else if (r.type == JournalRecordType::Owner) {
+            owner = static_cast<uint32_t>(r.order_id);
+        } else if (r.type == JournalRecordType::Clock) {
+            stats.expired += book.advance_time(r.order_id).size();
+        } else if (r.type == JournalRecordType::MassCancel) {
+            const uint32_t by = static_cast<uint32_t>(r.order_id);
+            std::span<const uint64_t> gone;
+            if (by == 0)         gone = book.mass_cancel(r.side, r.price, static_cast<int32_t>(static_cast<int64_t>(r.quantity)));
+            else if (r.reserved) gone = book.mass_cancel(by, r.side);
+            else                 gone = book.mass_cancel(by);
+            stats.mass_cancelled += gone.size();
+        } else if (r.type == JournalRecordType::Cancel) {
+            ++stats.cancels;
+            book.cancel_order(r.order_id);
+        } else if (r.type == JournalRecordType::Modify) {
+            ++stats.modifies;
+            stats.trades += book.modify_order(r.order_id, r.price, r.quantity).trades.size();
+        } else if (r.type == JournalRecordType::Stop) {
+            ++stats.stops;
+            book.place_stop(Order(r.side, r.order_type, r.price, r.quantity),
+                            static_cast<int32_t>(static_cast<int64_t>(r.order_id)), owner);
+            owner = 0;
+        } else if (r.type == JournalRecordType::Auction) {
+            book.start_auction();
+        } else if (r.type == JournalRecordType::Uncross) {
+            ++stats.auctions;
+            stats.trades += book.uncross(r.price).trades.size();
+        } else if (r.type == JournalRecordType::Iceberg) {
+            ++stats.icebergs;
+            auto result = book.process_iceberg(Order(r.side, r.order_type, r.price, r.quantity),
+                                               static_cast<Quantity>(r.order_id), owner);
+            owner = 0;
+            stats.trades += result.trades.size();
+        } else {
+            throw std::runtime_error("Unknown journal record type!");
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+// Journal.h - write-ahead input journal, and replay of it back into a book
+// nothing in the book survives the process dying. the journal records every input that changes
+// the book - every new order (each one burns an order ID, even if it's killed), and every cancel
+// or modify that actually hit a resting order - in sequence, before the book applies it. feeding the journal
+// back through process_order / cancel_order / modify_order on a fresh book rebuilds exactly the same book: same
+// order IDs, same trades, same queue positions, since matching is deterministic given the inputs.
+//
+// writes go straight into a memory-mapped journal file (a memcpy + an index bump on the matching
+// thread). a flusher thread wakes every flush_interval_us and syncs everything written since its
+// last pass to disk in one go - group commit - so process_order never waits on the disk.
+// durable_count() says how far the disk has caught up: a gateway that wants "acked means
+// survives a power cut" holds the ack back until its record is under that line. without that, a
+// crash loses at most the last flush interval (a process crash loses nothing - the page cache
+// still has it).
+//
+// file layout: a 64-byte JournalHeader, then 32-byte JournalRecords. the file is grown ahead of
+// the writer with ftruncate, so the unwritten tail is zeroes - a record with type 0 is the end.
+// reopening an existing journal carries on appending after its last record.
+
+#include "Order.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class OrderBook;
+
+enum class JournalRecordType : uint8_t {
+    End     = 0,   // zero-filled space past the last record
+    New     = 'N', // process_order
+    Cancel  = 'X', // cancel_order that removed an order
+    Modify  = 'M', // modify_order on a resting order
+    Stop    = 'S', // place_stop
+    Iceberg = 'I', // process_iceberg
+    Auction = 'A', // start_auction
+    Uncross = 'U', // uncross - price is the reference price
+    Expiry  = 'G', // the New right after it is GTT / Day - reserved is the TimeInForce
+    Clock   = 'C', // advance_time - order_id is the time
+    Owner   = 'O', // the New / Iceberg / Stop right after it belongs to order_id
+    MassCancel = 'K' // mass_cancel - see append_mass_cancel
+};
+
+struct JournalRecord {
+    JournalRecordType type;
+    OrderSide  side;       // New
+    OrderType  order_type; // New
+    uint8_t    reserved;
+    int32_t    price;      // New, Stop (limit price), Modify (new price) - ticks
+    uint64_t   seq;        // 1, 2, 3 ... with no gaps - a mismatch means a torn / corrupt file
+    uint64_t   quantity;   // New, Modify (new quantity)
+    uint64_t   order_id;   // New: the ID the book gave it, Cancel / Modify: the order it applies to,
+                           // Stop: the trigger price (sign-extended) - a record has no room for a
+                           // second price, and the stop's ID is just the next one, same as on replay.
+                           // Iceberg: the display quantity, same reasoning.
+                           // Expiry: the expire time (a Day order's is the close it was given),
+                           // Clock: the time. Owner, MassCancel: the owner
+};
+
+static_assert(sizeof(JournalRecord) == 32, "journal record layout changed");
+
+struct JournalHeader {
+    char     magic[8];    // "OBJRNL01"
+    uint64_t record_size; // sizeof(JournalRecord)
+    uint8_t  reserved[48];
+};
+
+static_assert(sizeof(JournalHeader) == 64, "journal header layout changed");
+
+struct JournalConfig {
+    std::string path;                           // created if it doesn't exist, appended to if it does
+    uint32_t    flush_interval_us = 200;        // how long the flusher waits between group commits
+    size_t      max_bytes = size_t(1) << 36;    // address space reserved for the file mapping
+};
+
+class Journal {
+public:
+    // throws std::runtime_error if the file can't be opened / mapped, or an existing file isn't a journal
+    explicit Journal(const JournalConfig& config);
+    ~Journal(); // final sync, then trims the file to the last record
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // --- called by OrderBook, matching thread only ---
+    void append_new(const Order& o, uint64_t order_id) {
+        append({JournalRecordType::New, o.side, o.type, 0, o.price, 0, o.quantity, order_id});
+    }
+    void append_cancel(uint64_t order_id) {
+        append({JournalRecordType::Cancel, OrderSide::Buy, OrderType::Limit, 0, 0, 0, 0, order_id});
+    }
+    void append_modify(uint64_t order_id, int32_t new_price, uint64_t new_quantity) {
+        append({JournalRecordType::Modify, OrderSide::Buy, OrderType::Limit, 0, new_price, 0, new_quantity, order_id});
+    }
+    // stops that fire aren't journaled - replaying the trades that set them off fires them again
+    void append_stop(const Order& o, int32_t trigger_price) {
+        append({JournalRecordType::Stop, o.side, o.type, 0, o.price, 0, o.quantity,
+                static_cast<uint64_t>(static_cast<int64_t>(trigger_price))});
+    }
+    void append_auction_start() {
+        append({JournalRecordType::Auction, OrderSide::Buy, OrderType::Limit, 0, 0, 0, 0, 0});
+    }
+    void append_uncross(int32_t reference_price) {
+        append({JournalRecordType::Uncross, OrderSide::Buy, OrderType::Limit, 0, reference_price, 0, 0, 0});
+    }
+    void append_iceberg(const Order& o, Quantity display_quantity) {
+        append({JournalRecordType::Iceberg, o.side, o.type, 0, o.price, 0, o.quantity, display_quantity});
+    }
+    // a record of its own in front of the New, rather than squeezed into it - the New keeps its
+    // order ID for the replay check, and a journal that ends between the two replays as if the
+    // order never came
+    void append_expiry(TimeInForce tif, uint64_t expire_time) {
+        append({JournalRecordType::Expiry, OrderSide::Buy, OrderType::Limit, static_cast<uint8_t>(tif), 0, 0, 0, expire_time});
+    }
+    void append_clock(uint64_t now) {
+        append({JournalRecordType::Clock, OrderSide::Buy, OrderType::Limit, 0, 0, 0, 0, now});
+    }
+    // in front of the record it applies to, the same way as append_expiry
+    void append_owner(uint32_t owner) {
+        append({JournalRecordType::Owner, OrderSide::Buy, OrderType::Limit, 0, 0, 0, 0, owner});
+    }
+    // one record for the whole call, not a Cancel per order - replay takes out the same ones.
+    // by owner: order_id the owner, reserved 1 if only `side`. by range: order_id 0, `side`,
+    // price the bottom and quantity the top (sign-extended)
+    void append_mass_cancel(uint32_t owner, bool one_side, OrderSide side, int32_t low, int32_t high) {
+        append({JournalRecordType::MassCancel, side, OrderType::Limit, static_cast<uint8_t>(one_side), low, 0,
+                static_cast<uint64_t>(static_cast<int64_t>(high)), owner});
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }           // records written
+    uint64_t durable_count() const { return durable_.load(std::memory_order_acquire); } // records on disk
+
+    // blocks until durable_count() catches up with everything written so far - shutdown / tests only
+    void sync() const;
+
+private:
+    JournalConfig config_;
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;
+    JournalRecord* records_ = nullptr;
+
+    std::atomic<uint64_t> count_{0};      // written by the matching thread, read by the flusher
+    uint64_t capacity_ = 0;               // matching thread's view of how many records fit in the file
+    std::atomic<uint64_t> file_records_{0}; // how many records fit in the file right now
+    std::atomic<uint64_t> durable_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex grow_mutex_;               // only the two growers take it, never on the normal append path
+    std::thread flusher_;
+    uint64_t prefaulted_ = 0;             // flusher only - records up to here have their pages mapped in
+
+    void append(JournalRecord r) {
+        const uint64_t n = count_.load(std::memory_order_relaxed);
+        if (n == capacity_) grow_for_writer(); // flusher normally keeps ahead, this is the fallback
+        r.seq = n + 1;
+        records_[n] = r;
+        count_.store(n + 1, std::memory_order_release);
+    }
+
+    void grow_for_writer();
+    bool grow_to(uint64_t records);
+    void flush_loop();
+    void flush_once();
+    void prefault(uint64_t written);
+};
+
+struct ReplayStats {
+    uint64_t records       = 0;
+    uint64_t new_orders    = 0;
+    uint64_t cancels       = 0;
+    uint64_t modifies      = 0;
+    uint64_t stops         = 0;
+    uint64_t icebergs      = 0;
+    uint64_t auctions      = 0; // uncrosses
+    uint64_t expired       = 0; // GTT / Day orders the replayed clock took out
+    uint64_t mass_cancelled = 0; // orders the replayed mass cancels took out
+    uint64_t trades        = 0;
+    uint64_t id_mismatches = 0; // resting orders that came back with a different ID - should stay 0
+    uint64_t oversized     = 0; // New / Stop / Iceberg records over this build's MAX_QUANTITY - skipped
+};
+
+// feeds every record in the journal at `path` into `book`, which should be fresh (or restored from
+// a snapshot taken at the journal position you're replaying from - see `from_seq`). the book must
+// not have a journal attached while this runs, or it would journal the replay too.
+// throws if the file isn't a journal or the records aren't in sequence
+ReplayStats replay_journal(const std::string& path, OrderBook& book, uint64_t from_seq = 1);
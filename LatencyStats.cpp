@@ -0,0 +1,81 @@
+#include "LatencyStats.h"
+#include <chrono>
+#include <thread>
+
+// LatencyStats.cpp - clock calibration, snapshots and percentiles
+// see LatencyStats.h for what gets recorded and the threading rules
+
+double tsc_ticks_per_ns() {
+    // count ticks across ~20 ms of wall clock. invariant TSC (every x86 from the last decade)
+    // ticks at a fixed rate whatever the core clock is doing, so once is enough
+    static const double ticks_per_ns = [] {
+        auto wall0 = std::chrono::steady_clock::now();
+        uint64_t t0 = tsc_now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto wall1 = std::chrono::steady_clock::now();
+        uint64_t t1 = tsc_now();
+        double ns = std::chrono::duration<double, std::nano>(wall1 - wall0).count();
+        return ns > 0 ? (t1 - t0) / ns : 1.0;
+    }();
+    return ticks_per_ns;
+}
+
+uint64_t LatencyHistogramData::percentile(double q) const {
+    if (count == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(q * count);
+    if (target >= count) target = count - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen > target) return bucket_low(i);
+    }
+    return max;
+}
+
+LatencySnapshot LatencySnapshot::since(const LatencySnapshot& earlier) const {
+    LatencySnapshot out = *this;
+    auto subtract = [](LatencyHistogramData& a, const LatencyHistogramData& b) {
+        a.count -= b.count;
+        a.sum -= b.sum;
+        for (size_t i = 0; i < LatencyHistogramData::BUCKETS; ++i) a.buckets[i] -= b.buckets[i];
+    };
+    for (size_t i = 0; i < out.ops.size(); ++i) subtract(out.ops[i], earlier.ops[i]);
+    for (size_t i = 0; i < out.by_trades.size(); ++i) subtract(out.by_trades[i], earlier.by_trades[i]);
+    return out;
+}
+
+LatencyStats::LatencyStats() {
+    if constexpr (LATENCY_STATS) {
+        hist_ = std::make_unique<Histograms>();
+        ticks_per_ns_ = tsc_ticks_per_ns();
+    }
+}
+
+void LatencyStats::Histogram::copy_to(LatencyHistogramData& out) const {
+    out.count = count.load(std::memory_order_relaxed);
+    out.sum   = sum.load(std::memory_order_relaxed);
+    out.max   = max.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < out.buckets.size(); ++i) out.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+}
+
+void LatencyStats::Histogram::clear() {
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+}
+
+LatencySnapshot LatencyStats::snapshot() const {
+    LatencySnapshot out;
+    out.ticks_per_ns = ticks_per_ns_;
+    if (!hist_) return out;
+    for (size_t i = 0; i < out.ops.size(); ++i) hist_->ops[i].copy_to(out.ops[i]);
+    for (size_t i = 0; i < out.by_trades.size(); ++i) hist_->by_trades[i].copy_to(out.by_trades[i]);
+    return out;
+}
+
+void LatencyStats::reset() {
+    if (!hist_) return;
+    for (auto& h : hist_->ops) h.clear();
+    for (auto& h : hist_->by_trades) h.clear();
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+// LatencyStats.h - hot-path latency histograms recorded inside OrderBook
+// the old way of measuring latency (two high_resolution_clock::now() calls around process_order
+// and sorting a vector afterwards) costs more than a lot of the operations it measures, and
+// can't say *what* was slow. this times every process_order / cancel_order / modify_order with
+// the cpu's timestamp counter (rdtsc - a few ns, no syscall) and counts it into fixed-size
+// log-linear histograms (HDR-style: 32 linear sub-buckets per power of two, so any value is
+// within ~3% of its bucket), one per kind of operation and one per number of trades generated.
+//
+// compiled in only with -DORDERBOOK_LATENCY_STATS. without it LATENCY_STATS is false, the
+// timing in OrderBook.cpp is compiled out and a LatencyStats holds no buckets at all.
+//
+// only the matching thread records. each bucket is a relaxed atomic it bumps with a plain
+// load + store (no locked instruction), so snapshot() can be called from any other thread at
+// any time and never slows the matcher down. a snapshot is a copy; to scrape intervals keep
+// the previous one and call since() rather than resetting the live counters
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef ORDERBOOK_LATENCY_STATS
+inline constexpr bool LATENCY_STATS = true;
+#else
+inline constexpr bool LATENCY_STATS = false;
+#endif
+
+// what kind of operation a sample was
+enum class LatencyOp : uint8_t {
+    LimitRest = 0, // limit order that rested without trading
+    Sweep     = 1, // limit / market order that traded (maybe resting a remainder)
+    IoC       = 2,
+    FokKill   = 3, // FOK that couldn't fill - dry run only
+    FokFill   = 4,
+    Cancel    = 5, // successful or not
+    Modify    = 6,
+    Count
+};
+
+// trades generated by one operation, bucketed: 0, 1, 2-3, 4-7, 8-15, 16+
+inline constexpr size_t TRADE_CLASSES = 6;
+
+inline size_t trade_class(size_t trades) {
+    if (trades == 0) return 0;
+    size_t c = 1 + (63 - static_cast<size_t>(__builtin_clzll(trades))); // 1 -> 1, 2-3 -> 2 ...
+    return c < TRADE_CLASSES ? c : TRADE_CLASSES - 1;
+}
+
+// timestamp counter in cpu ticks - rdtsc on x86, steady_clock nanoseconds anywhere else
+inline uint64_t tsc_now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+double tsc_ticks_per_ns(); // measured once against steady_clock on first call (~20 ms)
+
+// a copy of one histogram, in ticks - see LatencySnapshot for ns conversion
+struct LatencyHistogramData {
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB      = uint64_t(1) << SUB_BITS;
+    static constexpr unsigned MAX_EXP  = 40; // 2^40 ticks is minutes - anything longer lands in the last bucket
+    static constexpr size_t   BUCKETS  = (MAX_EXP - SUB_BITS + 1) * SUB + SUB;
+
+    static size_t bucket_of(uint64_t ticks) {
+        if (ticks < SUB) return static_cast<size_t>(ticks);
+        unsigned e = 63 - static_cast<unsigned>(__builtin_clzll(ticks));
+        size_t i = (static_cast<size_t>(e - SUB_BITS + 1) << SUB_BITS) + ((ticks >> (e - SUB_BITS)) & (SUB - 1));
+        return i < BUCKETS ? i : BUCKETS - 1;
+    }
+    static uint64_t bucket_low(size_t i) {
+        if (i < SUB) return i;
+        unsigned e = static_cast<unsigned>(i >> SUB_BITS) + SUB_BITS - 1;
+        return (SUB | (i & (SUB - 1))) << (e - SUB_BITS);
+    }
+
+    uint64_t count = 0;
+    uint64_t sum   = 0; // ticks, for the mean
+    uint64_t max   = 0; // ticks - never goes down, so a since() keeps the later max
+    std::array<uint64_t, BUCKETS> buckets{};
+
+    // plain (non-atomic) record, for a histogram only one thread ever sees - e.g. the bench harness
+    void add(uint64_t ticks) {
+        ++buckets[bucket_of(ticks)];
+        ++count;
+        sum += ticks;
+        if (ticks > max) max = ticks;
+    }
+
+    // lower edge of the bucket holding the q-th quantile (0.5 = median), in ticks
+    uint64_t percentile(double q) const;
+};
+
+struct LatencySnapshot {
+    double ticks_per_ns = 1.0;
+    std::array<LatencyHistogramData, static_cast<size_t>(LatencyOp::Count)> ops{};
+    std::array<LatencyHistogramData, TRADE_CLASSES> by_trades{};
+
+    const LatencyHistogramData& op(LatencyOp o) const { return ops[static_cast<size_t>(o)]; }
+
+    double to_ns(uint64_t ticks) const { return ticks / ticks_per_ns; }
+    double percentile_ns(const LatencyHistogramData& h, double q) const { return to_ns(h.percentile(q)); }
+    double mean_ns(const LatencyHistogramData& h) const { return h.count ? to_ns(h.sum) / h.count : 0.0; }
+
+    // what happened between `earlier` and this snapshot (both from the same LatencyStats)
+    LatencySnapshot since(const LatencySnapshot& earlier) const;
+};
+
+class LatencyStats {
+public:
+    LatencyStats(); // allocates the histograms (~130 KB) and calibrates the clock if LATENCY_STATS
+
+    LatencyStats(const LatencyStats&) = delete;
+    LatencyStats& operator=(const LatencyStats&) = delete;
+
+    // matching thread only
+    void record(LatencyOp op, size_t trades, uint64_t ticks) {
+        if constexpr (LATENCY_STATS) {
+            hist_->ops[static_cast<size_t>(op)].add(ticks);
+            hist_->by_trades[trade_class(trades)].add(ticks);
+        }
+    }
+
+    // any thread - a consistent-enough copy (each counter is exact, they're just not all read
+    // at the same instant). empty if LATENCY_STATS is off
+    LatencySnapshot snapshot() const;
+
+    // zero everything - matching thread only, or while nothing is matching
+    void reset();
+
+private:
+    struct Histogram {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::array<std::atomic<uint64_t>, LatencyHistogramData::BUCKETS> buckets{};
+
+        // single writer - load + store instead of fetch_add, so no lock prefix on the hot path
+        static void bump(std::atomic<uint64_t>& c, uint64_t by) {
+            c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        }
+        void add(uint64_t ticks) {
+            bump(buckets[LatencyHistogramData::bucket_of(ticks)], 1);
+            bump(count, 1);
+            bump(sum, ticks);
+            if (ticks > max.load(std::memory_order_relaxed)) max.store(ticks, std::memory_order_relaxed);
+        }
+        void copy_to(LatencyHistogramData& out) const;
+        void clear();
+    };
+    struct Histograms {
+        std::array<Histogram, static_cast<size_t>(LatencyOp::Count)> ops;
+        std::array<Histogram, TRADE_CLASSES> by_trades;
+    };
+
+    std::unique_ptr<Histograms> hist_; // null when LATENCY_STATS is off
+    double ticks_per_ns_ = 1.0;
+};
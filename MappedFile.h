@@ -0,0 +1,26 @@
+#pragma once
+
+// MappedFile.h - read-only memory mapping of a whole file
+// lets the decoder walk a captured message file as one contiguous byte buffer straight out of
+// the page cache - no read() calls, no copying into a userspace buffer first.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile {
+public:
+    // throws std::runtime_error if the file can't be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
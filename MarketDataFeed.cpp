@@ -0,0 +1,18 @@
+#include "MarketDataFeed.h"
+
+// MarketDataFeed.cpp - buffer setup and the conflation flush
+// the per-event publishing is inline in MarketDataFeed.h since it runs inside the matching loop
+
+MarketDataFeed::MarketDataFeed(size_t capacity, bool conflate)
+        : buf_(capacity), conflate_(conflate) {
+    pending_.reserve(MAX_PENDING);
+}
+
+void MarketDataFeed::flush_pending() {
+    for (const PendingLevel& p : pending_) {
+        // an order that rested and got cancelled inside the same message nets out to nothing
+        if (p.quantity == 0 && p.count == 0) continue;
+        push({MdEventType::Level, p.side, 0, p.price, p.count, 0, 0, 0, p.quantity});
+    }
+    pending_.clear();
+}
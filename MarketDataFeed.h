@@ -0,0 +1,136 @@
+#pragma once
+
+// MarketDataFeed.h - incremental L2 / L3 market data straight out of the matching path
+// instead of diffing whole book snapshots, the book tells the feed about every change as it
+// makes it: an order resting (Add), a resting order getting hit (Execute), a cancel (Delete),
+// an in-place size cut (Reduce), and what each of those did to the price level (Level).
+// a modify that moves an order is a Delete then an Add with the same order ID. events are fixed-size binary records
+// written into a preallocated buffer, so publishing never allocates.
+//
+// conflation (optional): level changes for the same side + price within one input message are
+// merged and published once when the message is done - so a sweep that eats 40 orders at one
+// price gives 40 Execute events but only one Level event for that price.
+//
+// OrderBook::set_market_data() turns it on - with no feed attached the hooks cost one branch.
+
+#include "Order.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+enum class MdEventType : uint8_t {
+    Add        = 'A', // L3: order started resting
+    Execute    = 'E', // L3: resting order was (partly) filled
+    Delete     = 'D', // L3: resting order was cancelled
+    Reduce     = 'R', // L3: resting order's size was cut in place (modify) - it keeps its queue position
+    Level      = 'L', // L2: quantity / order count at a price changed
+    Indicative = 'I'  // auction call phase: where the book would uncross right now (OrderBook::publish_indicative)
+};
+
+struct MarketDataEvent {
+    MdEventType type;
+    OrderSide   side;      // side of the book the change happened on (Indicative: the side left over)
+    uint16_t    reserved0;
+    int32_t     price;     // ticks
+    int32_t     count;     // Level: change in number of orders at the level
+    uint32_t    reserved1;
+    uint64_t    seq;       // feed sequence number - goes up by exactly 1 per event, gaps mean drops
+    uint64_t    order_id;  // Add / Execute / Delete (0 for Level)
+    int64_t     quantity;  // Add: resting qty, Execute: filled qty, Delete / Reduce: qty removed,
+                           // Level: change in total qty at the level (negative = shrank),
+                           // Indicative: volume that would execute. its order_id is the imbalance
+                           // (bids - asks, as two's complement) and price 0 means nothing crosses
+};
+
+static_assert(sizeof(MarketDataEvent) == 40, "market data layout changed");
+
+class MarketDataFeed {
+public:
+    // capacity: events the buffer holds before the consumer has to drain it
+    explicit MarketDataFeed(size_t capacity, bool conflate = false);
+
+    // --- called by OrderBook ---
+    void on_add(uint64_t order_id, OrderSide side, int32_t price, uint64_t qty) {
+        push({MdEventType::Add, side, 0, price, 0, 0, 0, order_id, static_cast<int64_t>(qty)});
+        on_level(side, price, static_cast<int64_t>(qty), +1);
+    }
+    // order_done: the fill took the resting order's quantity to zero, so it left the level
+    void on_execute(uint64_t order_id, OrderSide side, int32_t price, uint64_t qty, bool order_done) {
+        push({MdEventType::Execute, side, 0, price, 0, 0, 0, order_id, static_cast<int64_t>(qty)});
+        on_level(side, price, -static_cast<int64_t>(qty), order_done ? -1 : 0);
+    }
+    void on_delete(uint64_t order_id, OrderSide side, int32_t price, uint64_t qty) {
+        push({MdEventType::Delete, side, 0, price, 0, 0, 0, order_id, static_cast<int64_t>(qty)});
+        on_level(side, price, -static_cast<int64_t>(qty), -1);
+    }
+    void on_reduce(uint64_t order_id, OrderSide side, int32_t price, uint64_t qty) {
+        push({MdEventType::Reduce, side, 0, price, 0, 0, 0, order_id, static_cast<int64_t>(qty)});
+        on_level(side, price, -static_cast<int64_t>(qty), 0);
+    }
+    void on_indicative(int32_t price, uint64_t volume, int64_t imbalance) {
+        push({MdEventType::Indicative, imbalance >= 0 ? OrderSide::Buy : OrderSide::Sell, 0, price, 0, 0, 0,
+              static_cast<uint64_t>(imbalance), static_cast<int64_t>(volume)});
+    }
+    // end of one process_order / cancel_order / modify_order - publishes whatever level changes were held back
+    void end_message() {
+        if (!pending_.empty()) flush_pending();
+    }
+
+    // --- consumer side (same thread as the book) ---
+    std::span<const MarketDataEvent> events() const { return {buf_.data(), size_}; }
+    void clear() { size_ = 0; }
+
+    uint64_t dropped() const { return dropped_; } // events lost because the buffer was full
+    uint64_t next_seq() const { return next_seq_; }
+
+private:
+    // a level change waiting for end_message() - only used when conflating
+    struct PendingLevel {
+        OrderSide side;
+        int32_t   price;
+        int64_t   quantity;
+        int32_t   count;
+    };
+    // a message touching more distinct levels than this just publishes the overflow unconflated
+    static constexpr size_t MAX_PENDING = 64;
+
+    std::vector<MarketDataEvent> buf_; // sized once in the constructor, never grows
+    size_t size_ = 0;
+    uint64_t next_seq_ = 1;
+    uint64_t dropped_ = 0;
+
+    bool conflate_;
+    std::vector<PendingLevel> pending_; // reserved to MAX_PENDING, never grows past it
+
+    void push(MarketDataEvent ev) {
+        if (size_ == buf_.size()) {
+            ++dropped_;
+            ++next_seq_; // still burn the number so the consumer sees the gap
+            return;
+        }
+        ev.seq = next_seq_++;
+        buf_[size_++] = ev;
+    }
+
+    void on_level(OrderSide side, int32_t price, int64_t qty, int32_t count) {
+        if (!conflate_) {
+            push({MdEventType::Level, side, 0, price, count, 0, 0, 0, qty});
+            return;
+        }
+        for (PendingLevel& p : pending_) {
+            if (p.price == price && p.side == side) {
+                p.quantity += qty;
+                p.count += count;
+                return;
+            }
+        }
+        if (pending_.size() == MAX_PENDING) {
+            push({MdEventType::Level, side, 0, price, count, 0, 0, 0, qty});
+            return;
+        }
+        pending_.push_back({side, price, qty, count});
+    }
+
+    void flush_pending();
+};
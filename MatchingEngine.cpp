@@ -0,0 +1,98 @@
+#include "MatchingEngine.h"
+
+// MatchingEngine.cpp - shard threads and their run loop
+// see MatchingEngine.h for how symbols are split across shards
+
+MatchingEngine::MatchingEngine(const MatchingEngineConfig& config) : config_(config) {
+    if (config_.num_shards == 0) {
+        throw std::invalid_argument("MatchingEngine needs at least one shard");
+    }
+    shards_.reserve(config_.num_shards);
+    for (uint32_t i = 0; i < config_.num_shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>(config_.queue_capacity));
+    }
+}
+
+MatchingEngine::~MatchingEngine() {
+    stop();
+}
+
+void MatchingEngine::start() {
+    if (running_.exchange(true)) return;
+
+    for (uint32_t i = 0; i < config_.num_shards; ++i) {
+        shards_[i]->thread = std::thread(&MatchingEngine::run_shard, this, i);
+    }
+    // books get built on their own shard thread (after pinning) so their memory is first-touched
+    // on the right core / NUMA node - wait for all of them before letting any orders in
+    for (auto& shard : shards_) {
+        while (!shard->ready.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+}
+
+void MatchingEngine::stop() {
+    if (!running_.exchange(false)) return;
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) shard->thread.join();
+    }
+}
+
+void MatchingEngine::run_shard(uint32_t shard_idx) {
+    if (config_.pin_threads) pin_this_thread(config_.first_core + shard_idx);
+
+    Shard& shard = *shards_[shard_idx];
+    if (shard.books.empty()) {
+        // symbols shard_idx, shard_idx + num_shards, shard_idx + 2*num_shards, ...
+        for (uint32_t sym = shard_idx; sym < config_.num_symbols; sym += config_.num_shards) {
+            shard.books.push_back(std::make_unique<OrderBook>(config_.book));
+        }
+    }
+    shard.ready.store(true, std::memory_order_release);
+
+    Command cmd;
+    IdleWaiter waiter(config_.wait);
+    while (true) {
+        if (!shard.inbox.try_pop(cmd)) {
+            // only exit once stop() has been called *and* the inbox is drained
+            if (!running_.load(std::memory_order_acquire) && shard.inbox.empty()) break;
+            waiter.idle();
+            continue;
+        }
+        waiter.reset();
+
+        OrderBook& book = *shard.books[cmd.symbol / config_.num_shards];
+        if (cmd.oversized()) {
+            ++shard.stats.rejected;
+        } else if (cmd.type == CommandType::New) {
+            Order order(cmd.side, cmd.order_type, cmd.price, cmd.quantity);
+            auto result = cmd.tif == TimeInForce::GTC && cmd.owner == 0
+                              ? book.process_order(order)
+                              : book.process_order(order, cmd.tif, cmd.expire_time, cmd.owner);
+            shard.stats.trades += result.trades.size();
+            ++shard.stats.orders;
+        } else if (cmd.type == CommandType::Clock) {
+            shard.stats.expired += book.advance_time(cmd.now).size();
+        } else if (cmd.type == CommandType::MassCancel) {
+            shard.stats.mass_cancelled += book.mass_cancel(cmd).size();
+        } else if (cmd.type == CommandType::AuctionStart) {
+            book.start_auction();
+        } else if (cmd.type == CommandType::Uncross) {
+            shard.stats.trades += book.uncross(cmd.price).trades.size();
+        } else if (cmd.type == CommandType::Iceberg) {
+            auto result = book.process_iceberg(Order(cmd.side, OrderType::Iceberg, cmd.price, cmd.quantity), cmd.display_quantity,
+                                               cmd.owner);
+            shard.stats.trades += result.trades.size();
+            ++shard.stats.orders;
+        } else if (cmd.type == CommandType::Stop) {
+            book.place_stop(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity), cmd.trigger_price,
+                            cmd.owner);
+            ++shard.stats.orders;
+        } else if (cmd.type == CommandType::Modify) {
+            shard.stats.trades += book.modify_order(cmd.order_id, cmd.price, cmd.quantity).trades.size();
+            ++shard.stats.modifies;
+        } else {
+            book.cancel_order(cmd.order_id);
+            ++shard.stats.cancels;
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// MatchingEngine.h - runs lots of order books (one per symbol) across several matcher threads
+// a single OrderBook is one instrument on one thread. the engine owns many of them and splits
+// the symbols into shards - each shard gets its own thread (pinned to its own core), its own
+// books and its own SpscRing inbox. a symbol always lives on the same shard, so a book is only
+// ever touched by one thread and nothing on the matching path needs a lock.
+//
+// flow: gateway thread -> submit(cmd) -> shard inbox ring -> shard thread -> OrderBook
+
+#include "Command.h"
+#include "OrderBook.h"
+#include "SpscRing.h"
+#include "WaitStrategy.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+struct MatchingEngineConfig {
+    uint32_t num_shards     = 1;      // matcher threads - one per core you want to give the engine
+    uint32_t num_symbols    = 1;      // books are created for symbol IDs 0 .. num_symbols-1
+    size_t   queue_capacity = 65536;  // commands each shard's inbox can hold before submit() says no
+    bool     pin_threads    = true;   // pin shard i to core (first_core + i)
+    uint32_t first_core     = 0;
+    WaitStrategy wait       = WaitStrategy::Backoff; // what an idle shard does - see WaitStrategy.h
+
+    // sizing for every book - the OrderBook defaults are ~140 MB each, so with thousands of
+    // symbols you want this cut right down to what one instrument actually needs
+    OrderBookConfig book;
+};
+
+// per-shard counters - only the shard thread writes these, read them after stop()
+struct ShardStats {
+    uint64_t orders   = 0;
+    uint64_t cancels  = 0;
+    uint64_t modifies = 0;
+    uint64_t trades   = 0;
+    uint64_t expired  = 0; // GTT / Day orders Clock commands took out
+    uint64_t mass_cancelled = 0; // orders MassCancel commands took out - one command per symbol
+    uint64_t rejected = 0; // New / Stop / Iceberg with a quantity over MAX_QUANTITY - never applied
+};
+
+class MatchingEngine {
+public:
+    explicit MatchingEngine(const MatchingEngineConfig& config);
+    ~MatchingEngine();
+
+    // spawns the shard threads and waits until every one has built its books
+    void start();
+
+    // drains whatever is still queued, then joins the shard threads
+    void stop();
+
+    // gateway side - must only ever be called from one thread (each inbox is single-producer)
+    // returns false if the target shard's inbox is full, the caller decides whether to retry
+    bool submit(const Command& cmd) {
+        if (cmd.symbol >= config_.num_symbols) {
+            throw std::out_of_range("Unknown symbol!");
+        }
+        return shards_[shard_of(cmd.symbol)]->inbox.try_push(cmd);
+    }
+
+    uint32_t shard_of(uint32_t symbol) const { return symbol % config_.num_shards; }
+    uint32_t num_shards() const { return config_.num_shards; }
+
+    const ShardStats& shard_stats(uint32_t shard) const { return shards_[shard]->stats; }
+
+    // direct access to a symbol's book - only safe while the engine is stopped
+    OrderBook& book(uint32_t symbol) {
+        return *shards_[shard_of(symbol)]->books[symbol / config_.num_shards];
+    }
+
+private:
+    // aligned so two shards' hot fields never end up sharing a cache line
+    struct alignas(CACHE_LINE) Shard {
+        explicit Shard(size_t capacity) : inbox(capacity) {}
+
+        SpscRing<Command> inbox;
+        std::vector<std::unique_ptr<OrderBook>> books; // index = symbol / num_shards
+        ShardStats stats;
+        std::atomic<bool> ready{false};
+        std::thread thread;
+    };
+
+    MatchingEngineConfig config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> running_{false};
+
+    void run_shard(uint32_t shard_idx);
+};
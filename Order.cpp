@@ -6,22 +6,25 @@
 // default constructor - everything zeroed out
 Order::Order()
         : order_id(0),
+          has_cold(0),
           side(OrderSide::Buy),
           type(OrderType::Limit),
           price(0),
           quantity(0),
-          seq(0)
+          prev(nullptr),
+          next(nullptr)
 {}
 
 // the one you actually use when submitting an order
-Order::Order(OrderSide s, OrderType t, int32_t p, uint64_t q)
+Order::Order(OrderSide s, OrderType t, int32_t p, Quantity q)
         : order_id(0),
-          client_order_id(0),
+          has_cold(0),
           side(s),
           type(t),
           price(p),
           quantity(q),
-          seq(0) {
+          prev(nullptr),
+          next(nullptr) {
 }
 
 // order is done when quantity hits 0
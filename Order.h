@@ -15,24 +15,70 @@ enum class OrderSide : uint8_t {
 };
 
 enum class OrderType : uint8_t {
-    Limit  = 0, // sits in the book if it doesn't immediately match
-    Market = 1, // matches at any price, never sits in the book
-    IoC    = 2, // immediate-or-cancel: fill what you can at the limit price, cancel the rest
-    FOK    = 3  // fill-or-kill: fill the whole thing right now or cancel it entirely
+    Limit   = 0, // sits in the book if it doesn't immediately match
+    Market  = 1, // matches at any price, never sits in the book
+    IoC     = 2, // immediate-or-cancel: fill what you can at the limit price, cancel the rest
+    FOK     = 3, // fill-or-kill: fill the whole thing right now or cancel it entirely
+    Iceberg = 4  // a limit order that only shows part of its size at a time - see Iceberg.h.
+                 // goes in through OrderBook::process_iceberg, not process_order
 };
 
+// how long a resting order lives. Order itself has no room left for it (or for a GTT's expiry
+// time), so it goes beside the order - OrderBook::process_order(order, tif, expire_time) - and
+// the book keeps the expiry in a timer wheel keyed by order ID (see TimerWheel.h)
+enum class TimeInForce : uint8_t {
+    GTC = 0, // good till cancelled - the default, what plain process_order does
+    Day = 1, // cancelled at the book's day close (OrderBook::set_day_close)
+    GTT = 2  // good till time - cancelled once the book's clock reaches expire_time
+};
+
+// resting quantities are 32-bit - the binary order-entry protocol already caps them there, and
+// half-width quantities are what get Order down to 32 bytes (two per cache line). build with
+// -DORDERBOOK_WIDE_QUANTITY for 64-bit quantities (Order goes to 40 bytes, Trade to 32)
+#ifdef ORDERBOOK_WIDE_QUANTITY
+using Quantity = uint64_t;
+#else
+using Quantity = uint32_t;
+#endif
+inline constexpr Quantity MAX_QUANTITY = static_cast<Quantity>(~Quantity(0));
+
+// only what matching touches lives here - the same struct is the pool node for a resting order,
+// so every byte is paid for on every level walk. order IDs get 47 bits (years of IDs at 10M a
+// second) so a flag, side and type fit in the same word. there used to be a seq too - always
+// equal to order_id, so it's gone rather than moved. the rest of the cold data is in OrderCold
 struct Order {
-    uint64_t order_id;
-    uint64_t client_order_id;
-    OrderSide side;
-    OrderType type;
-    int32_t price;    // price in ticks (1 tick = $0.01, so $100.00 = 10000)
-    uint64_t quantity;
-    uint64_t seq;     // just a counter that goes up with each order - used for fifo priority
-                      // way cheaper than calling chrono::now() on every single order
+    uint64_t  order_id : 47;
+    uint64_t  has_cold : 1; // its OrderCold has been filled in - only then is the cold array read
+    OrderSide side     : 8;
+    OrderType type     : 8;
+    int32_t   price;    // price in ticks (1 tick = $0.01, so $100.00 = 10000)
+    Quantity  quantity;
+
+    // links for the intrusive fifo at this order's price level (see PriceLevel in PriceLadder.h)
+    // only meaningful while the order is resting - the order *is* the queue node, so
+    // appending, popping and cancelling never allocate or shift anything
+    Order* prev;
+    Order* next;
 
     Order();
-    Order(OrderSide s, OrderType t, int32_t p, uint64_t q);
+    Order(OrderSide s, OrderType t, int32_t p, Quantity q);
 
     bool is_filled() const;
 };
+
+inline constexpr uint64_t MAX_ORDER_ID = (uint64_t(1) << 47) - 1;
+
+struct OwnerList; // OwnerIndex.h
+
+// what a resting order carries that matching never reads. it doesn't go in Order - it lives in a
+// parallel array with one entry per pool slot (OrderPool::cold, or inside an IcebergOrder), so a
+// level walk never drags it through the cache. only the reporting paths read it, and only for an
+// order whose has_cold is set - OrderBook::attach_cold fills one in the first time it's needed
+struct OrderCold {
+    uint64_t   client_order_id; // the gateway's ID for it, echoed on cancel / replace reports
+    OwnerList* owner;           // the owner list it's on (see OwnerIndex.h), nullptr if it has none
+    Order*     owner_prev;      // its neighbours on that list
+    Order*     owner_next;
+};
+
+static_assert(sizeof(Order) == (sizeof(Quantity) == 4 ? 32 : 40), "Order layout changed");
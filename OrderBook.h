@@ -8,66 +8,245 @@
 
 #include "Order.h"
 #include "Trade.h"
+#include "Command.h"
+#include "ResultSink.h"
 #include "OrderPool.h"
-#include <map>
+#include "OrderIdMap.h"
+#include "PriceLadder.h"
+#include "MarketDataFeed.h"
+#include "TradeLog.h"
+#include "Journal.h"
+#include "LatencyStats.h"
+#include "StopBook.h"
+#include "Iceberg.h"
+#include "Auction.h"
+#include "TopOfBook.h"
+#include "TimerWheel.h"
+#include "OwnerIndex.h"
+#include <iosfwd>
+#include <memory>
 #include <span>
+#include <string>
 #include <vector>
 
-// PriceLevel replaces std::deque<Order*> at each price level in the book
-// the key thing here is pop_front() - with a deque that involves block pointer chasing
-// with this it's literally just head++ which is basically free
-// all the order pointers sit in one contiguous vector so the cpu prefetcher is happy
-struct PriceLevel {
-    std::vector<Order*> orders;
-    size_t head = 0; // index of the first live order - everything before this has been matched
-
-    bool   empty()    const { return head >= orders.size(); }
-    Order* front()    const { return orders[head]; }
-    void   pop_front()      { head++; } // just move the head forward, no memory freed
-    void   push_back(Order* o) { orders.push_back(o); }
-    void   clear()          { orders.clear(); head = 0; }
-
-    // iterators start from head so range-for and std::find only see live orders
-    std::vector<Order*>::iterator       begin()       { return orders.begin() + head; }
-    std::vector<Order*>::iterator       end()         { return orders.end(); }
-    std::vector<Order*>::const_iterator begin() const { return orders.begin() + head; }
-    std::vector<Order*>::const_iterator end()   const { return orders.end(); }
-
-    void erase(std::vector<Order*>::iterator it) { orders.erase(it); }
-};
-
 // what happened to an order after process_order runs
 enum class OrderStatus : uint8_t {
     Resting,     // limit order sitting in the book (maybe partially filled)
     Filled,      // completely matched
     PartialFill, // IoC: matched what it could, rest was cancelled
     Killed,      // FOK: couldn't fill the whole thing so the whole thing was cancelled
+    Cancelled,   // cancel_order took it out of the book
+    Rejected,    // cancel / modify for an order that isn't resting (already filled, unknown ID),
+                 // or an order the call can't take (an Iceberg through process_order, a market /
+                 // IoC / FOK order during an auction, a limit priced further from the rest of its
+                 // side than the ladder band can stretch - see PriceLadder::fits)
+    Pending,     // place_stop: waiting for its trigger price to trade
+    Expired,     // a GTT / Day order advance_time took out (runner / engine / batch reports)
 };
 
 struct ProcessOrderResult {
     // span instead of vector - this is just a pointer+size pointing at the orderbook's internal
     // trades buffer. no copy, no allocation. just don't use it after the next process_order call
     std::span<const Trade> trades;
-    uint64_t new_order_id = 0; // only set if the order is now resting in the book
+    uint64_t new_order_id = 0; // only set if the order is now resting in the book (or waiting as a stop)
     OrderStatus status = OrderStatus::Filled;
+    uint32_t stops_triggered = 0; // stops this call's trades set off - their trades are in `trades` too,
+                                  // after this order's own, in the order the stops fired
 };
 
+// sizing for one book - everything gets allocated up front from these so nothing reallocates
+// mid-session (the order pool and ID map can still grow if a session outruns them). the defaults
+// are what the single-instrument benchmark needs (~200 MB); a multi-symbol engine running
+// thousands of books wants them a lot smaller (see MatchingEngine.h)
+struct OrderBookConfig {
+    size_t   initial_orders = 2'500'000; // pool slots mapped up front - the pool grows past this if it has to
+    size_t   pool_chunk     = 65536;     // slots added per growth step (4 MB of orders)
+    HugePages huge_pages    = HugePages::Transparent; // backing for the pool and the ID map pages
+    size_t   trade_history  = 1 << 20;   // trades kept in memory (a ring) - see TradeLog.h
+    std::string trade_log_path;          // spill the history to this file on a background thread -
+                                         // empty keeps only the most recent trade_history trades.
+                                         // one file per book
+    int32_t  ladder_centre  = 10000;     // where the price band starts out ($100.00)
+    uint32_t ladder_ticks   = 4096;      // width of the price band - re-centres if a price falls outside
+    bool     prefix_index   = false;     // keep a Fenwick tree over level quantities - O(log N) FOK checks
+                                         // and risk queries, at the cost of a tree update per fill
+    uint64_t expiry_resolution = 1'000'000; // clock units per expiry wheel tick (1 ms with a nanosecond
+                                            // clock) - GTT / Day orders expire up to one tick late, never early
+};
 
 class OrderBook {
 public:
-    OrderBook();
+    explicit OrderBook(const OrderBookConfig& config = OrderBookConfig{});
     ~OrderBook();
 
     ProcessOrderResult process_order(Order new_order);
 
-    const std::vector<Trade>& get_trade_history() const;
+    // good-till-time / day: new_order goes in exactly as above, but whatever of it rests is taken
+    // out automatically once the book's clock (advance_time) reaches its expiry - expire_time for
+    // GTT, the day close for Day (GTC is just the call above). Rejected without matching if that
+    // time has already passed, or it's Day and there's no close set. the expiry sits in a timer
+    // wheel beside the order, keyed by its ID - fills, cancels and the call above never touch it
+    // (see TimerWheel.h). modify_order keeps the expiry, like the ID.
+    // owner tags what rests with who it belongs to, for mass_cancel - 0 is nobody
+    ProcessOrderResult process_order(Order new_order, TimeInForce tif, uint64_t expire_time = 0, uint32_t owner = 0);
+
+    // the book's clock, in whatever unit the caller likes (ns since midnight, since the epoch ...)
+    // as long as expire times and the close use the same one. advance_time moves it forward and
+    // takes out every GTT / Day order whose expiry it has reached, in one pass - a market data
+    // delete for each and one end_message, one top-of-book publish - and returns their IDs
+    // (valid until the next advance_time). a time at or before the current one does nothing.
+    // journaled, so a replay expires the same orders at the same point
+    std::span<const uint64_t> advance_time(uint64_t now);
+    uint64_t current_time() const { return clock_; }
+
+    // when Day orders expire - orders already resting keep the close they went in with
+    void set_day_close(uint64_t close_time) { day_close_ = close_time; }
+    uint64_t day_close() const { return day_close_; }
+
+    // entries waiting in the expiry wheel - includes orders that have since filled or been
+    // cancelled, which drop out when their time comes
+    size_t pending_expiries() const { return expiries_ ? expiries_->size() : 0; }
+
+    // cancel-on-disconnect / kill switch - everything an owner has in the book (and its waiting
+    // stops), or just one side of it, in one call. the owner's orders are linked together through
+    // their cold entries, per side in a few lanes (see OwnerIndex.h), so it's a walk from order to
+    // order with no lookups, and the other side costs nothing. the IDs come back lane by lane, not
+    // in time order. by price range: every order on `side` at a price in [low, high], owner or not -
+    // each level in range goes as a whole, its orders handed back and the level dropped in one go
+    // rather than unlinked one at a time. each way there's a market
+    // data delete per order and one end_message, one top-of-book publish, and the IDs taken out
+    // come back (valid until the next mass_cancel). journaled
+    std::span<const uint64_t> mass_cancel(uint32_t owner);
+    std::span<const uint64_t> mass_cancel(uint32_t owner, OrderSide side);
+    std::span<const uint64_t> mass_cancel(OrderSide side, int32_t low, int32_t high);
+    // whichever of the three a MassCancel command asks for (see Command.h)
+    std::span<const uint64_t> mass_cancel(const Command& cmd);
+
+    // every trade so far (file + ring, or just the recent window without a trade log file)
+    TradeHistory get_trade_history() const;
     bool cancel_order(uint64_t order_id);
+
+    // amend a resting order in one call, keeping its order ID
+    //   same price, quantity down (or unchanged) - shrunk in place, keeps its queue position
+    //   new price or quantity up - goes to the back of the queue at the new price, and if the new
+    //   price crosses it matches straight away like an incoming limit order
+    //   new_quantity 0 - same as cancel_order (status Cancelled)
+    // no new ID, pool slot or lookup entry either way. status is Resting / Filled, or Rejected if
+    // the order isn't resting (or new_quantity is over MAX_QUANTITY, or it's an iceberg - cancel
+    // and re-send those). new_order_id is the (unchanged) ID if it's still resting
+    ProcessOrderResult modify_order(uint64_t order_id, int32_t new_price, uint64_t new_quantity);
+
+    // the client's own ID for a resting order - kept in the order's cold entry (see OrderCold),
+    // not in Order, since only reports want it. ProtocolDecoder sets it when a new order rests and
+    // echoes it on cancel / replace reports. set is false if the order isn't resting, get is 0 if
+    // it isn't or never had one. not journaled or snapshotted - it's the gateway's, not the book's
+    bool set_client_order_id(uint64_t order_id, uint64_t client_order_id);
+    uint64_t client_order_id(uint64_t order_id) const;
+
+    // stop / stop-limit: `order` waits off the book until a trade prints at or through
+    // trigger_price (at or above for a buy, at or below for a sell), then goes in exactly as if
+    // process_order had been called with it - a Market order for a plain stop, a Limit for a
+    // stop-limit (IoC / FOK work too). it gets its ID now and keeps it when it fires. status is
+    // Pending. cancel_order takes it back out; modify_order doesn't apply until it has fired.
+    // whatever fires runs straight after the order whose trades set it off, and its trades can
+    // set off more (see StopBook.h for the firing order). owner as for process_order - a stop
+    // that fires and rests is still the owner's
+    ProcessOrderResult place_stop(Order order, int32_t trigger_price, uint32_t owner = 0);
+    size_t pending_stops() const { return stops_ ? stops_->size() : 0; }
+
+    // iceberg: a limit order for order.quantity in total that only ever shows display_quantity of
+    // it in the book. it matches on the way in like a limit for its whole size, then rests one
+    // slice at a time - each time a slice fills the next one goes to the back of the same price
+    // level, same order ID (see Iceberg.h). depth, market data, the FOK dry run and the risk
+    // queries only see the displayed slice. cancel_order takes out the lot. Rejected if
+    // display_quantity is 0. order.type is ignored (it becomes OrderType::Iceberg). owner as for
+    // process_order
+    ProcessOrderResult process_iceberg(Order order, Quantity display_quantity, uint32_t owner = 0);
+
+    // call auction for the open / close (see Auction.h). after start_auction, limit and iceberg
+    // orders rest without matching even if they cross, so the book can be crossed. market / IoC /
+    // FOK orders are Rejected, a modify re-rests at its new price without matching, cancels and
+    // stops work as normal. indicative_price says what uncross would do right now;
+    // publish_indicative sends that to the market data feed as an Indicative event, but only if it
+    // changed since the last one it sent - cheap enough to call after every order in the call.
+    // uncross executes everything that crosses at the equilibrium price (every trade at that one
+    // price, best-priced orders first on each side, fifo within a level), fires any stops those
+    // trades set off, and goes back to continuous matching. start and uncross are journaled
+    void start_auction();
+    bool in_auction() const { return auction_; }
+    AuctionResult indicative_price(int32_t reference_price = 0) const;
+    void publish_indicative(int32_t reference_price = 0);
+    AuctionResult uncross(int32_t reference_price = 0);
+
+    // batch versions for a gateway that receives messages in bursts. every message is applied
+    // exactly as the single calls would apply it (same IDs, same trades, same journal records),
+    // but while one is matched the levels / lookup slots / orders the next few will touch are
+    // prefetched, and the results go back to back into `sink` (cleared first - see ResultSink.h).
+    // process_commands takes the runner's Command (any CommandType) and ignores its symbol
+    void process_orders(std::span<const Order> orders, ResultSink& sink);
+    void process_commands(std::span<const Command> commands, ResultSink& sink);
+
+    // matching thread only - another thread wants a TopOfBook (set_top_of_book) instead
     int32_t get_best_bid() const;
     int32_t get_best_ask() const;
+
+    // top-of-book depth for one side, best price first, straight from the per-level totals -
+    // never touches individual orders. fills at most out.size() rows, returns how many it filled
+    size_t get_depth(OrderSide side, std::span<DepthLevel> out) const;
+
+    // pre-trade risk queries - "what would an incoming order on `side` run into"
+    // O(log N) with config.prefix_index on, otherwise they walk the price levels
+    // available_quantity: how much it could fill at or better than limit_price
+    // sweep_price: the worst price it would reach filling qty (0 if the book can't fill it)
+    // both count iceberg reserve - it trades at its price even though get_depth doesn't show it
+    uint64_t available_quantity(OrderSide side, int32_t limit_price) const;
+    int32_t  sweep_price(OrderSide side, uint64_t qty) const;
     void print_order_book() const;
 
+    // attach an incremental market data feed (or nullptr to turn it off) - every change to the book
+    // gets published to it as it happens. the book doesn't own the feed
+    void set_market_data(MarketDataFeed* feed) { md_ = feed; }
+
+    // attach a seqlocked top-of-book block (or nullptr to stop) - after every call that changes the
+    // top top->levels() levels of either side, the book writes the BBO, that depth and the last
+    // trade into it, and any number of other threads can read it without locks (see TopOfBook.h).
+    // a process_orders / process_commands batch publishes once, at the end. publishes the current
+    // state straight away. the book doesn't own it
+    void set_top_of_book(TopOfBook* top);
+
+    // attach a write-ahead journal (or nullptr to stop journaling) - every new order and every
+    // successful cancel / modify is appended before the book applies it. the book doesn't own the journal.
+    // to recover: replay_journal() into a fresh book, then attach a Journal on the same file
+    void set_journal(Journal* journal) { journal_ = journal; }
+
+    // snapshot of everything resting (see Snapshot.h) - restarting is load_snapshot() into a fresh
+    // book, then replay_journal() from the returned journal seq + 1
+    // save_snapshot writes it on this thread. save_snapshot_async forks and writes it from the
+    // child's copy-on-write view, so matching carries on straight away - returns the child's pid,
+    // wait_snapshot(pid) says whether it worked. save / load throw std::runtime_error on failure
+    void save_snapshot(const std::string& path) const;
+    int  save_snapshot_async(const std::string& path) const;
+    static bool wait_snapshot(int pid);
+    uint64_t load_snapshot(const std::string& path); // returns the journal seq the snapshot covers
+
+    // empty the book out so it matches exactly like a new one with the same config - nothing
+    // resting, no stops, continuous matching, IDs from 1 again, no trade history - but without
+    // giving back anything it has mapped (pool slabs, the ID map page, the ladders, scratch
+    // buffers). for running one replay after another on the same book instead of building a
+    // ~140 MB one each time (see ReplayRunner.h). O(resting orders). the price band stays wherever
+    // it last re-centred to, nothing goes to the market data feed, the top of book republishes.
+    // throws if a journal is attached or the trade history spills to a file
+    void reset();
+
+    // per-operation latency histograms - only filled in when built with -DORDERBOOK_LATENCY_STATS
+    // (see LatencyStats.h). snapshot() is safe from any thread while the book is running
+    const LatencyStats& latency_stats() const { return latency_; }
+    void reset_latency_stats() { latency_.reset(); } // matching thread only
+
 private:
-    std::vector<Trade> executed_trades_; // full history of every trade - pre-reserved so it never reallocates
+    // trade history - a fixed ring the matching loop writes into, drained to a file by its own
+    // thread. recording a trade never allocates or blocks
+    TradeLog trade_log_;
 
     // reusable buffer - match_and_fill writes trades here instead of allocating a new vector every call
     // the result span points into this, so the caller sees the trades without any copying
@@ -75,22 +254,170 @@ private:
 
     uint64_t next_order_id_ = 1;
 
-    // bids sorted high-to-low (best bid first), asks sorted low-to-high (best ask first)
-    // using int32_t ticks as the key - way faster than comparing doubles
-    std::map<int32_t, PriceLevel, std::greater<int32_t>> bids_;
-    std::map<int32_t, PriceLevel, std::less<int32_t>>    asks_;
+    // one flat ladder per side, indexed directly by tick - best bid is the highest occupied level,
+    // best ask is the lowest. see PriceLadder.h for the bitmap that makes those searches cheap
+    PriceLadder bids_;
+    PriceLadder asks_;
 
-    // flat array indexed by order_id for O(1) cancel lookup
+    // order_id -> resting order for O(1) cancel lookup
     // order IDs are just sequential ints starting at 1 so we can use them directly as indices
     // way faster than unordered_map which has to hash + chase pointers through heap nodes
-    std::vector<Order*> order_lookup_;
+    // paged, so there's no cap on IDs - see OrderIdMap.h
+    OrderIdMap order_lookup_;
 
     OrderPool order_pool_;
+    IcebergPool icebergs_; // resting icebergs live here instead of order_pool_ - see Iceberg.h
+
+    MarketDataFeed* md_ = nullptr; // optional - see set_market_data()
+    Journal* journal_ = nullptr;   // optional - see set_journal()
+    TopOfBook* top_ = nullptr;     // optional - see set_top_of_book()
+
+    // per side, the best price this call has changed inside the published levels - rows in front
+    // of it can't have moved, so publish_top rewalks the side from there. a change at or better
+    // than the last row published (or anywhere on a side showing fewer rows than it has room for)
+    // counts, anything further back can't move what's in the block
+    int32_t top_bid_dirty_ = INT32_MIN; // highest bid price changed, INT32_MIN for none
+    int32_t top_ask_dirty_ = INT32_MAX; // lowest ask price changed, INT32_MAX for none
+    bool top_batch_ = false; // inside process_orders / process_commands - publish once at the end
+    int32_t top_bid_floor_ = INT32_MIN;
+    int32_t top_ask_ceiling_ = INT32_MAX;
+    int32_t top_prices_[2][TOP_LEVELS] = {}; // rows as last staged, best first - [0] bids, [1] asks
+    uint32_t top_rows_[2] = {};
+
+    LatencyStats latency_; // empty unless LATENCY_STATS
+
+    // stops waiting for their trigger - only made when the first stop comes in, so a book that
+    // never sees one pays nothing for it (not even the trigger check after a trade)
+    std::unique_ptr<StopBook> stops_;
+
+    // call auction - see start_auction(). the solver only holds scratch arrays, so working out an
+    // indicative price on a const book is fine
+    bool auction_ = false;
+    mutable AuctionSolver auction_solver_;
+    AuctionResult last_indicative_; // what publish_indicative sent last
+
+    // GTT / Day expiry - the wheel is only made for the first order with an expiry, like stops_
+    std::unique_ptr<TimerWheel> expiries_;
+    uint64_t clock_ = 0;
+    uint64_t day_close_ = 0;
+    uint64_t expiry_resolution_;
+    std::vector<uint64_t> expired_buf_; // what advance_time hands back
+
+    // owner -> its order lists for mass_cancel (see OwnerIndex.h) - made for the first order with
+    // an owner, like stops_
+    std::unique_ptr<OwnerIndex> owners_;
+    std::vector<uint64_t> cancelled_buf_; // what mass_cancel hands back
+    std::vector<Order*>   owned_buf_;     // one side of an owner's orders, gathered by cancel_owned
 
     friend std::ostream& operator<<(std::ostream& os, const OrderBook& book);
 
-    void match_and_fill(Order& new_order); // writes into trades_buf_, no return value
+    // what the public calls do, without the latency timing wrapped round them
+    ProcessOrderResult process_order_untimed(Order new_order_data);
+    bool cancel_order_untimed(uint64_t order_id);
+    ProcessOrderResult modify_order_untimed(uint64_t order_id, int32_t new_price, uint64_t new_quantity);
+    ProcessOrderResult process_iceberg_untimed(Order order, Quantity display_quantity, uint32_t owner);
+
+    // picks the process_new specialisation for the order's side and type
+    ProcessOrderResult dispatch_new(Order& incoming);
+
+    // a level at `price` changed - callers check top_ first
+    void touch_top(OrderSide side, int32_t price) {
+        if (side == OrderSide::Buy) {
+            if (price >= top_bid_floor_ && price > top_bid_dirty_) top_bid_dirty_ = price;
+        } else {
+            if (price <= top_ask_ceiling_ && price < top_ask_dirty_) top_ask_dirty_ = price;
+        }
+    }
+    // restage every row on both sides - a new block, a reset, a snapshot or the auction flag moving
+    void touch_top_all() {
+        top_bid_dirty_ = INT32_MAX;
+        top_ask_dirty_ = INT32_MIN;
+    }
+    void restage_top(OrderSide side, int32_t dirty); // one side, from the first row at or behind dirty
+    // end of a public call - republishes if it traded (`trades`) or touched the published levels,
+    // unless it's part of a batch
+    void publish_top(std::span<const Trade> trades);
+
+    TimerWheel& expiry_wheel(); // expiries_, made on first use
+    // wheel ticks: an expiry rounds up (never early), the clock rounds down
+    uint64_t expiry_tick(uint64_t time) const { return time / expiry_resolution_ + (time % expiry_resolution_ != 0); }
+
+    // takes a resting order out of its level, the lookup and its pool, and sends the market
+    // data delete - what cancel and expiry have in common. callers send end_message
+    void remove_resting(Order* order);
+    // a resting order's cold entry - in the pool's cold array, or in its IcebergOrder. found by
+    // address, not by reading the order's type, so walking an owner list doesn't wait on each
+    // order before it can find the next. attach_cold clears it and sets has_cold the first time,
+    // so a reused slot never shows the last order's data
+    OrderCold& cold(const Order* order) const {
+        if (OrderCold* c = order_pool_.find_cold(order)) return *c;
+        return const_cast<IcebergOrder*>(as_iceberg(order))->cold;
+    }
+    OrderCold& attach_cold(Order* order);
+    // whether a limit at `price` can rest on `side` - see PriceLadder::fits
+    bool can_rest(OrderSide side, int32_t price) const {
+        return (side == OrderSide::Buy ? bids_ : asks_).fits(price);
+    }
+
+    // puts an order that's resting (or a stop that's waiting) on the end of its owner's list (the
+    // lane for its ID). link_owned when the caller already has it - `stop` says which of the lists
+    void tag_owner(uint32_t owner, uint64_t order_id);
+    OwnerIndex& owner_index(); // owners_, made on first use
+    void prefetch_owner_link(uint32_t owner, OrderSide side); // what tag_owner will write, before the order goes in
+    void link_owned(OwnerList& list, Order* order, bool stop);
+    // takes one off its owner's list - c is its cold entry, or a copy of it for a stop that just
+    // fired (and order the same for the Order)
+    void unlink_owned(const OrderCold& c, const Order& order, bool stop);
+    // a resting order / waiting stop with has_cold set is going for good - off its owner's list if it's on one
+    void release_cold(Order* order) {
+        const OrderCold& c = cold(order);
+        if (c.owner) unlink_owned(c, *order, false);
+    }
+    void release_stop_cold(Order* stop) {
+        const OrderCold& c = stop_cold(stop);
+        if (c.owner) unlink_owned(c, *stop, true);
+    }
+    // mass_cancel by owner proper - `one_side` false takes both sides. walks the owner's lanes in turn
+    std::span<const uint64_t> cancel_owned(uint32_t owner, bool one_side, OrderSide side);
+    // takes every level on `side` in [low, high] out whole, orders and all. report: market data
+    // deletes and IDs into cancelled_buf_ (mass_cancel) or not (reset)
+    void drop_levels(OrderSide side, int32_t low, int32_t high, bool report);
+
+    // runs every stop the trades in trades_buf_ set off, cascades included - returns how many fired
+    uint32_t fire_stops();
+    StopBook& stop_book(int32_t centre); // stops_, made on first use
+
+    // a new order once its side and type are known - FOK dry run, matching, resting / dropping
+    // the remainder. process_order_untimed picks the specialisation, nothing below branches on type.
+    // display is only used by Iceberg (the slice size it rests with)
+    template <OrderSide Side, OrderType Type>
+    ProcessOrderResult process_new(Order& incoming, Quantity display = 0);
+
+    // writes into trades_buf_, no return value. Market drops the limit-price check.
+    // an iceberg whose slice fills gets refilled in place here
+    template <OrderSide Side, bool Market>
+    void match_and_fill(Order& incoming);
+
+    // a resting order at the front of `level` has just been filled - unlink it and give its slot
+    // back, or if it's an iceberg with more to show, refill it and move it to the back
+    void retire_front(PriceLadder& book, PriceLevel& level, int32_t price, OrderSide side);
+
+    // uncross() proper - `volume` at `price`, best bids against best asks
+    void execute_auction(int32_t price, uint64_t volume);
+
+    // batch prefetch pipeline - stage 0 is furthest ahead, each stage reads what the one before
+    // it pulled in (lookup slot -> order -> its level and neighbours). a batch of commands only
+    // uses stages 0 and 1
+    void prefetch_new(OrderSide side, int32_t price) const;
+    void prefetch_command(const Command& cmd, int stage) const;
+    void prefetch_resting(uint64_t order_id, int stage) const; // cancel / modify / expiry
+    // all three stages for ids[i + ...] - a loop taking out a list of IDs calls this for each i
+    void prefetch_ids(std::span<const uint64_t> ids, size_t i) const;
+
+    // the snapshot writer proper - no allocation or exceptions, so it's safe in a forked child
+    bool write_snapshot_file(const char* tmp_path, const char* path, uint8_t* buf) const;
 
     // used for FOK only - dry run to check if we can fill the whole order before touching the book
+    template <OrderSide Side>
     bool can_fill_completely(const Order& order) const;
 };
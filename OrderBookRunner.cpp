@@ -0,0 +1,133 @@
+#include "OrderBookRunner.h"
+
+// OrderBookRunner.cpp - the run loop that drains the ingress ring into the book
+// see OrderBookRunner.h for the overall picture
+
+OrderBookRunner::OrderBookRunner(OrderBook& book, const OrderBookRunnerConfig& config)
+        : book_(book),
+          config_(config),
+          ingress_(config.ingress_capacity),
+          egress_(config.egress_capacity) {
+}
+
+OrderBookRunner::~OrderBookRunner() {
+    stop();
+}
+
+void OrderBookRunner::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread(&OrderBookRunner::run, this);
+}
+
+void OrderBookRunner::stop() {
+    if (!running_.exchange(false)) return;
+    if (thread_.joinable()) thread_.join();
+}
+
+void OrderBookRunner::run() {
+    if (config_.pin_thread) pin_this_thread(config_.core);
+
+    Command cmd;
+    IdleWaiter waiter(config_.wait);
+    while (true) {
+        if (!ingress_.try_pop(cmd)) {
+            // only exit once stop() has been called *and* everything submitted has been applied
+            if (!running_.load(std::memory_order_acquire) && ingress_.empty()) break;
+            waiter.idle();
+            continue;
+        }
+        waiter.reset();
+        apply(cmd);
+    }
+}
+
+void OrderBookRunner::apply(const Command& cmd) {
+    const uint64_t seq = next_seq_++;
+    Event status{EventType::Status, cmd.type, OrderStatus::Rejected, 0, seq, cmd.order_id, 0, 0};
+
+    // trades first, then the status - the reader knows a command is finished when its status shows up
+    auto emit_result = [&](const ProcessOrderResult& result) {
+        for (const Trade& t : result.trades) {
+            emit({EventType::Trade, cmd.type, OrderStatus::Filled, t.price, seq,
+                  t.buyer_order_id, t.seller_order_id, t.quantity});
+        }
+        status.status   = result.status;
+        status.order_id = result.new_order_id;
+    };
+
+    if (cmd.oversized()) {
+        status.order_id = 0;
+        emit(status);
+        return;
+    }
+
+    switch (cmd.type) {
+        case CommandType::New: {
+            Order order(cmd.side, cmd.order_type, cmd.price, cmd.quantity);
+            emit_result(cmd.tif == TimeInForce::GTC && cmd.owner == 0
+                            ? book_.process_order(order)
+                            : book_.process_order(order, cmd.tif, cmd.expire_time, cmd.owner));
+            break;
+        }
+
+        case CommandType::Cancel:
+            status.status = book_.cancel_order(cmd.order_id) ? OrderStatus::Cancelled : OrderStatus::Rejected;
+            break;
+
+        case CommandType::Modify: {
+            // keeps its ID - and its queue position if it's only a size cut. rejected if it's gone
+            emit_result(book_.modify_order(cmd.order_id, cmd.price, cmd.quantity));
+            status.order_id = cmd.order_id;
+            break;
+        }
+
+        case CommandType::Stop:
+            emit_result(book_.place_stop(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity), cmd.trigger_price,
+                                         cmd.owner));
+            break;
+
+        case CommandType::AuctionStart:
+            book_.start_auction();
+            status.status = OrderStatus::Pending;
+            break;
+
+        case CommandType::Uncross: {
+            AuctionResult result = book_.uncross(cmd.price);
+            for (const Trade& t : result.trades) {
+                emit({EventType::Trade, cmd.type, OrderStatus::Filled, t.price, seq,
+                      t.buyer_order_id, t.seller_order_id, t.quantity});
+            }
+            status.status = OrderStatus::Filled;
+            break;
+        }
+
+        case CommandType::Iceberg:
+            emit_result(book_.process_iceberg(Order(cmd.side, OrderType::Iceberg, cmd.price, cmd.quantity), cmd.display_quantity,
+                                              cmd.owner));
+            break;
+
+        case CommandType::Clock:
+            for (uint64_t id : book_.advance_time(cmd.now)) {
+                emit({EventType::Expired, cmd.type, OrderStatus::Expired, 0, seq, id, 0, 0});
+            }
+            status.status   = OrderStatus::Expired;
+            status.order_id = 0;
+            break;
+
+        case CommandType::MassCancel:
+            for (uint64_t id : book_.mass_cancel(cmd)) {
+                emit({EventType::Cancelled, cmd.type, OrderStatus::Cancelled, 0, seq, id, 0, 0});
+            }
+            status.status   = OrderStatus::Cancelled;
+            status.order_id = 0;
+            break;
+    }
+    emit(status);
+}
+
+void OrderBookRunner::emit(const Event& ev) {
+    // the egress ring being full means the report thread has fallen behind - we can't drop
+    // execution reports, so this is the one place the run loop waits on someone else
+    IdleWaiter waiter(config_.wait);
+    while (!egress_.try_push(ev)) waiter.idle();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// OrderBookRunner.h - puts one OrderBook on its own thread behind a pair of lock-free rings
+// process_order / cancel_order are plain synchronous calls, but in production orders come in on a
+// network thread and reports go out on another one. the runner sits in between:
+//
+//   gateway thread  --submit(Command)-->  ingress SpscRing  -->  run loop (owns the OrderBook)
+//   report thread   <--poll(Event)-----   egress SpscRing   <--
+//
+// neither hand-off ever takes a mutex - each ring has exactly one producer and one consumer.
+// the run loop can busy-spin or back off when the ingress ring is empty (see WaitStrategy.h).
+
+#include "Command.h"
+#include "Event.h"
+#include "OrderBook.h"
+#include "SpscRing.h"
+#include "WaitStrategy.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+struct OrderBookRunnerConfig {
+    size_t       ingress_capacity = 65536;  // commands queued before submit() says no
+    size_t       egress_capacity  = 262144; // events queued before the run loop has to wait for the reader
+    WaitStrategy wait             = WaitStrategy::BusySpin;
+    bool         pin_thread       = false;  // pin the run loop thread to `core`
+    uint32_t     core             = 0;
+};
+
+class OrderBookRunner {
+public:
+    // the runner doesn't own the book - once start() is called nobody else should touch it
+    // until stop() returns
+    OrderBookRunner(OrderBook& book, const OrderBookRunnerConfig& config = OrderBookRunnerConfig{});
+    ~OrderBookRunner();
+
+    OrderBookRunner(const OrderBookRunner&) = delete;
+    OrderBookRunner& operator=(const OrderBookRunner&) = delete;
+
+    // spawn the run loop thread / ask it to finish. stop() lets it drain the ingress ring first
+    void start();
+    void stop();
+
+    // gateway thread only - false if the ingress ring is full
+    bool submit(const Command& cmd) { return ingress_.try_push(cmd); }
+
+    // report thread only - false if there's nothing new
+    bool poll(Event& out) { return egress_.try_pop(out); }
+
+private:
+    OrderBook& book_;
+    OrderBookRunnerConfig config_;
+
+    SpscRing<Command> ingress_;
+    SpscRing<Event>   egress_;
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    uint64_t next_seq_ = 0; // only touched by the run loop thread
+
+    void run();
+    void apply(const Command& cmd);
+    void emit(const Event& ev);
+};
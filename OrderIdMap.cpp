@@ -0,0 +1,87 @@
+#include "OrderIdMap.h"
+#include <sys/mman.h>
+
+// OrderIdMap.cpp - page mapping / unmapping, see OrderIdMap.h
+// every slot in a page is nullptr again by the time its live count hits zero, so a released page
+// can be handed straight back out as a fresh one without clearing it
+
+OrderIdMap::OrderIdMap(HugePages huge_pages) : huge_pages_(huge_pages) {
+    // a 1024-page directory covers 268M IDs before it has to grow - it's 8 bytes per page anyway
+    pages_.reserve(1024);
+    live_.reserve(1024);
+    chunks_.reserve(1024);
+    move_to_page(0);
+}
+
+OrderIdMap::~OrderIdMap() {
+    for (const Chunk& c : chunks_) unmap_chunk(c);
+    unmap_chunk(spare_);
+}
+
+void OrderIdMap::move_to_page(uint64_t page) {
+    if (page > current_page_) {
+        // the page we're leaving is finished issuing IDs - if nothing from it is resting, drop it
+        // now (nothing else would, since erase() only releases a page when its last order goes)
+        uint64_t old = current_page_;
+        current_page_ = page;
+        if (old < pages_.size() && pages_[old] != nullptr && live_[old] == 0) release_page(old);
+    }
+    // an older page can still get an insert out of order (restoring a book) - map it if needed
+    map_page(page);
+}
+
+void OrderIdMap::map_page(uint64_t page) {
+    if (page >= pages_.size()) {
+        pages_.resize(page + 1, nullptr);
+        live_.resize(page + 1, 0);
+        chunks_.resize(page + 1);
+    }
+    if (pages_[page] != nullptr) return;
+
+    Chunk c = spare_;
+    if (c.ptr) {
+        spare_ = {};
+    } else {
+        c = map_chunk(PAGE_SIZE * sizeof(Order*), huge_pages_); // zero-filled = all nullptr
+    }
+    chunks_[page] = c;
+    pages_[page] = static_cast<Order**>(c.ptr);
+    ++mapped_;
+}
+
+void OrderIdMap::release_page(uint64_t page) {
+    if (spare_.ptr) unmap_chunk(spare_);
+    spare_ = chunks_[page];
+    chunks_[page] = {};
+    pages_[page] = nullptr;
+    --mapped_;
+}
+
+void OrderIdMap::reserve(uint64_t max_id) {
+    // jump current_page_ straight to the end, so inserting into the lower pages in any order
+    // doesn't retire them one by one - trim() afterwards drops any that stayed empty
+    const uint64_t last = max_id >> PAGE_BITS;
+    if (last > current_page_) current_page_ = last;
+    for (uint64_t page = 0; page <= last; ++page) {
+        map_page(page);
+#ifdef MADV_POPULATE_WRITE
+        ::madvise(chunks_[page].ptr, chunks_[page].bytes, MADV_POPULATE_WRITE);
+#endif
+    }
+}
+
+void OrderIdMap::trim() {
+    for (uint64_t page = 0; page < current_page_ && page < pages_.size(); ++page) {
+        if (pages_[page] != nullptr && live_[page] == 0) release_page(page);
+    }
+}
+
+void OrderIdMap::restart() {
+    // only the current page can still be mapped (erase() dropped the rest as they emptied) -
+    // releasing it makes it the spare, which map_page(0) then takes straight back
+    for (uint64_t page = 1; page < pages_.size(); ++page) {
+        if (pages_[page] != nullptr) release_page(page);
+    }
+    current_page_ = 0;
+    map_page(0);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// OrderIdMap.h - order ID -> resting Order*, with no upper limit on IDs
+// IDs are handed out sequentially for the whole session, so a flat array indexed by ID is the
+// fastest possible lookup - but a flat array has to be sized for the whole day up front.
+// this splits the ID space into fixed pages of 2^18 slots (2 MB - one huge page each) behind a
+// small directory. a page is only mapped once an order with an ID in its range rests, and gets
+// unmapped again once every order in it has gone and the IDs have moved past it - so memory
+// tracks how many orders are *resting*, not how many IDs have ever been issued.
+// lookup is still O(1): directory[id >> 18][id & mask], two dependent loads instead of one.
+
+#include "HugePages.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Order;
+
+class OrderIdMap {
+public:
+    static constexpr unsigned PAGE_BITS = 18;
+    static constexpr uint64_t PAGE_SIZE = uint64_t(1) << PAGE_BITS;
+    static constexpr uint64_t PAGE_MASK = PAGE_SIZE - 1;
+
+    explicit OrderIdMap(HugePages huge_pages = HugePages::None);
+    ~OrderIdMap();
+
+    OrderIdMap(const OrderIdMap&) = delete;
+    OrderIdMap& operator=(const OrderIdMap&) = delete;
+
+    // nullptr if the ID isn't resting (filled, cancelled, never issued)
+    Order* find(uint64_t id) const {
+        uint64_t page = id >> PAGE_BITS;
+        if (page >= pages_.size() || pages_[page] == nullptr) return nullptr;
+        return pages_[page][id & PAGE_MASK];
+    }
+
+    void insert(uint64_t id, Order* order) {
+        uint64_t page = id >> PAGE_BITS;
+        if (page != current_page_) move_to_page(page);
+        pages_[page][id & PAGE_MASK] = order;
+        ++live_[page];
+    }
+
+    // id must currently be in the map
+    void erase(uint64_t id) {
+        uint64_t page = id >> PAGE_BITS;
+        pages_[page][id & PAGE_MASK] = nullptr;
+        if (--live_[page] == 0 && page != current_page_) release_page(page);
+    }
+
+    // bulk loading (snapshot restore) inserts IDs in price order, not ID order - map and fault in
+    // every page up to max_id first, prefetch() each slot a few orders ahead of inserting it,
+    // then trim() to drop any page that ended up with nothing in it
+    void reserve(uint64_t max_id);
+    void trim();
+
+    // everything has been erased - start handing out IDs from page 0 again, reusing whichever
+    // page is still mapped rather than unmapping it and mapping a new one (OrderBook::reset)
+    void restart();
+    void prefetch(uint64_t id) const {
+        uint64_t page = id >> PAGE_BITS;
+        if (page < pages_.size() && pages_[page] != nullptr) __builtin_prefetch(&pages_[page][id & PAGE_MASK], 1);
+    }
+
+    size_t mapped_pages() const { return mapped_; }
+
+private:
+    HugePages huge_pages_;
+    std::vector<Order**>  pages_;  // directory - nullptr for pages with nothing resting
+    std::vector<uint32_t> live_;   // resting orders per page
+    std::vector<Chunk>    chunks_; // mapping behind each page, to unmap it again
+    Chunk spare_{};                // last released page, kept to save an mmap when the next one opens
+    uint64_t current_page_ = 0;    // page the newest IDs land in - never released while IDs still go there
+    size_t mapped_ = 0;
+
+    // cold paths - only once every 2^18 IDs
+    void move_to_page(uint64_t page);
+    void map_page(uint64_t page);
+    void release_page(uint64_t page);
+};
@@ -1,34 +1,44 @@
 #include "OrderPool.h"
-#include <stdexcept>
+#include <new>
 
 // OrderPool.cpp - implementation of the memory pool
 // see OrderPool.h for the explanation of why this exists
 
-OrderPool::OrderPool(size_t size) {
-    // allocate all the order slots up front in one big vector
-    // this means they're all contiguous in memory which is good for cache
-    pool_.resize(size);
+OrderPool::OrderPool(size_t initial_orders, size_t chunk_orders, HugePages huge_pages)
+        : chunk_orders_(chunk_orders > 0 ? chunk_orders : 1), huge_pages_(huge_pages) {
+    slabs_.reserve(64);
+    // the initial slots go in one mapping, so they're all contiguous in memory like before
+    if (initial_orders > 0) grow(initial_orders);
+}
 
-    // fill the free list with pointers to every slot
-    // we treat it as a stack - push/pop from the back which is O(1)
-    free_list_.reserve(size);
-    for (auto& order : pool_) {
-        free_list_.push_back(&order);
+OrderPool::~OrderPool() {
+    // Order is trivially destructible, so just hand the memory back
+    for (const Slab& s : slabs_) {
+        unmap_chunk(s.order_chunk);
+        unmap_chunk(s.cold_chunk);
     }
 }
 
-Order* OrderPool::get_order() {
-    if (free_list_.empty()) {
-        throw std::runtime_error("Order pool exhausted!");
-    }
+void OrderPool::grow(size_t orders) {
+    Chunk c = map_chunk(orders * sizeof(Order), huge_pages_);
 
-    // pop from the back of the stack - O(1), no searching
-    Order* order = free_list_.back();
-    free_list_.pop_back();
-    return order;
-}
+    // the mapping may have been rounded up to a whole huge page - use all of it
+    size_t n = c.bytes / sizeof(Order);
+    Order* slots = static_cast<Order*>(c.ptr);
 
-void OrderPool::return_order(Order* order) {
-    // push back onto the stack so it can be reused next time
-    free_list_.push_back(order);
+    // the cold side goes on the same pages as the orders - a mass cancel walks the owner links
+    // through it one hop after another, and on 4 KB pages nearly every hop was a TLB miss too
+    Chunk cold = map_chunk(n * sizeof(OrderCold), huge_pages_);
+    slabs_.push_back({c, cold, slots, static_cast<OrderCold*>(cold.ptr), n});
+
+    // thread the new slots onto the free list in address order, so they get handed out
+    // front to back - the first orders of the session sit next to each other
+    Order* head = free_head_;
+    for (size_t i = n; i-- > 0;) {
+        Order* o = new (&slots[i]) Order();
+        o->next = head;
+        head = o;
+    }
+    free_head_ = head;
+    capacity_ += n;
 }
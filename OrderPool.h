@@ -5,25 +5,87 @@
 // we pre-allocate a big block of Order objects at startup and hand them out as needed.
 // OrderBook grabs one with get_order() and gives it back with return_order() when it's done.
 // this keeps allocation cost out of the hot path completely.
+//
+// the pool grows: when the free list runs dry it maps another fixed-size chunk and carries on,
+// rather than throwing. chunks are never moved or freed while the pool lives, so an Order*
+// handed out stays valid for as long as the order does. growing costs an mmap + page faults
+// on the matching thread, so size initial_orders for a normal day and treat growth as the
+// safety net. chunks can be backed by huge pages - see HugePages.h
+//
+// each chunk of orders has a parallel chunk of OrderCold, one per slot, for what matching never
+// reads (see Order.h). it's mapped alongside but never touched by get / return - the mapping is
+// zero-filled and only committed page by page as cold entries are written, so a session that
+// never uses one costs nothing but address space
 
 #include "Order.h"
+#include "HugePages.h"
+#include <cstddef>
 #include <vector>
-#include <memory>
-
-// pre-allocates a big chunk of Order objects up front so we never have to call
-// malloc/free during the actual matching - just grab one from the pool and give it back when done
 
 class OrderPool {
 public:
-    explicit OrderPool(size_t size);
+    // initial_orders: slots mapped up front, chunk_orders: slots added each time it runs out
+    OrderPool(size_t initial_orders, size_t chunk_orders, HugePages huge_pages = HugePages::None);
+    ~OrderPool();
+
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
 
-    // grab an order from the pool - throws if you somehow run out
-    Order* get_order();
+    // grab an order from the pool - maps another chunk if it's empty
+    Order* get_order() {
+        if (free_head_ == nullptr) grow(chunk_orders_);
+        Order* order = free_head_;
+        free_head_ = order->next;
+        ++in_use_;
+        return order;
+    }
 
     // give an order back to the pool so it can be reused
-    void return_order(Order* order);
+    // the free list is threaded through Order::next - a free order isn't in any price level
+    void return_order(Order* order) {
+        order->next = free_head_;
+        free_head_ = order;
+        --in_use_;
+    }
+
+    // make sure at least `total` slots exist - restoring a snapshot pre-grows to the old size
+    // so the session doesn't pay for the growth in the middle of trading
+    void reserve(size_t total) {
+        if (total > capacity_) grow(total - capacity_);
+    }
+
+    // the cold entry for one of this pool's slots, nullptr if it isn't one - a range check per
+    // chunk (normally there's only the one), from the address alone, so it never waits on the order
+    OrderCold* find_cold(const Order* order) const {
+        for (const Slab& s : slabs_) {
+            if (order >= s.orders && order < s.orders + s.count) return &s.cold[order - s.orders];
+        }
+        return nullptr;
+    }
+
+    // the slot get_order hands out next, nullptr if it has to grow first - only a hint, a
+    // return_order before then puts another slot in front of it
+    const Order* peek() const { return free_head_; }
+
+    size_t capacity() const { return capacity_; } // slots mapped so far
+    size_t in_use()   const { return in_use_; }
+    size_t chunks()   const { return slabs_.size(); }
 
 private:
-    std::vector<Order> pool_;       // the actual storage - all orders live here
-    std::vector<Order*> free_list_; // stack of pointers to the available slots
+    struct Slab {
+        Chunk      order_chunk;
+        Chunk      cold_chunk;
+        Order*     orders;
+        OrderCold* cold;  // cold[i] goes with orders[i]
+        size_t     count;
+    };
+
+    Order* free_head_ = nullptr; // LIFO free list - the most recently freed (cache-warm) slot goes out first
+    size_t in_use_ = 0;
+    size_t capacity_ = 0;
+    size_t chunk_orders_;
+    HugePages huge_pages_;
+    std::vector<Slab> slabs_;
+
+    void grow(size_t orders); // cold path
 };
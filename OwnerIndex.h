@@ -0,0 +1,88 @@
+#pragma once
+
+// OwnerIndex.h - which orders belong to which owner (a session, a trader, a risk account), for
+// OrderBook::mass_cancel - cancel-on-disconnect, a risk kill switch. Order has no room left for
+// an owner, so an owner's orders are intrusive doubly linked lists threaded through their cold
+// entries (OrderCold::owner_prev / owner_next, see Order.h). resting orders and waiting stops get
+// separate lists, since one lives in the pool and the other in StopBook and their cold entries
+// are found different ways.
+//
+// walking one long list is a chain of cache misses, each waiting on the last - the next order is
+// only known once this one's cold entry is in. so each side is split LANES ways by order ID (see
+// lane()), and mass_cancel walks the lanes a step at a time in turn, keeping that many misses
+// going at once (drop_levels does the same across price levels). the lane comes from the ID, not
+// the address, so a replay puts everything in the same lane and cancels in the same order. each
+// lane is oldest first; across lanes there's no time order.
+//
+// the book takes an order off its list the moment it fills, is cancelled or expires. those paths
+// only look at the cold side if Order::has_cold is set, so orders nobody owns never touch it.
+// mass_cancel goes straight from one order to the next - no ID lookups, and nothing on the lists
+// that's already gone or on the other side
+
+#include "Order.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+struct OwnerList {
+    static constexpr size_t LANES = 8;
+
+    struct Ends {
+        Order* head = nullptr; // oldest - mass_cancel starts here
+        Order* tail = nullptr; // newest - new ones go on after it
+    };
+    uint32_t owner = 0;
+    Ends resting[2][LANES]; // by OrderSide, then lane
+    Ends stops[2][LANES];
+
+    // runs of 128 consecutive IDs take turns. an owner's orders spread over every lane however its
+    // IDs interleave with everyone else's, and one step across the lanes stays close to ID order -
+    // which is slot order in a fresh pool, so the walk reads memory nearly front to back
+    static size_t lane(uint64_t order_id) { return (order_id >> 7) % LANES; }
+
+    bool empty(size_t side) const {
+        for (size_t l = 0; l < LANES; ++l) {
+            if (resting[side][l].head || stops[side][l].head) return false;
+        }
+        return true;
+    }
+};
+
+class OwnerIndex {
+public:
+    OwnerIndex() = default;
+
+    OwnerIndex(const OwnerIndex&) = delete;
+    OwnerIndex& operator=(const OwnerIndex&) = delete;
+
+    // the owner's lists - made (empty) the first time it's asked for
+    OwnerList& list_for(uint32_t owner) {
+        if (last_ == nullptr || owner != last_->owner) {
+            last_ = &lists_[owner];
+            last_->owner = owner;
+        }
+        return *last_;
+    }
+
+    // nullptr if the owner never had anything
+    OwnerList* find(uint32_t owner) {
+        auto it = lists_.find(owner);
+        return it == lists_.end() ? nullptr : &it->second;
+    }
+
+    void clear() {
+        lists_.clear();
+        last_ = nullptr;
+    }
+
+    // every owner's lists - for snapshots. doesn't allocate
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto& [owner, list] : lists_) f(list);
+    }
+
+private:
+    // nodes never move, so an OrderCold can point at its list (and last_ stays valid)
+    std::unordered_map<uint32_t, OwnerList> lists_;
+    OwnerList* last_ = nullptr; // a session's orders tend to come in runs
+};
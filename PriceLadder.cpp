@@ -0,0 +1,265 @@
+#include "PriceLadder.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+// PriceLadder.cpp - the bitmap searches and the (rare) band re-centring
+// everything that runs per order is inline in PriceLadder.h
+
+// hard cap on how wide a band can get - 16M ticks is $167k of range at 1 tick = $0.01,
+// past that a price is almost certainly garbage and we'd rather throw than allocate gigabytes
+static constexpr uint32_t MAX_LADDER_TICKS = 1u << 24;
+
+OccupancyBitmap::OccupancyBitmap(size_t bits) : bits_(bits) {
+    leaf_.assign((bits + 63) / 64, 0);
+    mid_.assign((leaf_.size() + 63) / 64, 0);
+    top_.assign((mid_.size() + 63) / 64, 0);
+}
+
+size_t OccupancyBitmap::find_next(size_t i) const {
+    if (i >= bits_) return npos;
+
+    // 1. rest of the current leaf word
+    size_t w = i >> 6;
+    uint64_t bits = leaf_[w] & (~0ULL << (i & 63));
+    if (bits) return (w << 6) + __builtin_ctzll(bits);
+
+    // 2. rest of the current mid word - each bit here is a non-empty leaf word
+    size_t j = w + 1;
+    size_t mw = j >> 6;
+    if (j < leaf_.size()) {
+        bits = mid_[mw] & (~0ULL << (j & 63));
+        if (bits) {
+            size_t lw = (mw << 6) + __builtin_ctzll(bits);
+            return (lw << 6) + __builtin_ctzll(leaf_[lw]);
+        }
+    }
+
+    // 3. top level - there's only one top word until the band passes 262144 ticks
+    size_t k = mw + 1;
+    for (size_t tw = k >> 6; tw < top_.size(); ++tw) {
+        bits = top_[tw];
+        if (tw == (k >> 6)) bits &= ~0ULL << (k & 63);
+        if (bits) {
+            size_t mword = (tw << 6) + __builtin_ctzll(bits);
+            size_t lw = (mword << 6) + __builtin_ctzll(mid_[mword]);
+            return (lw << 6) + __builtin_ctzll(leaf_[lw]);
+        }
+    }
+    return npos;
+}
+
+size_t OccupancyBitmap::find_prev(size_t i) const {
+    if (bits_ == 0) return npos;
+    if (i >= bits_) i = bits_ - 1;
+
+    // same three steps as find_next, mirrored - mask off everything above i and take the top bit
+    size_t w = i >> 6;
+    uint64_t bits = leaf_[w] & (~0ULL >> (63 - (i & 63)));
+    if (bits) return (w << 6) + 63 - __builtin_clzll(bits);
+    if (w == 0) return npos;
+
+    size_t j = w - 1;
+    size_t mw = j >> 6;
+    bits = mid_[mw] & (~0ULL >> (63 - (j & 63)));
+    if (bits) {
+        size_t lw = (mw << 6) + 63 - __builtin_clzll(bits);
+        return (lw << 6) + 63 - __builtin_clzll(leaf_[lw]);
+    }
+    if (mw == 0) return npos;
+
+    size_t k = mw - 1;
+    for (size_t tw = (k >> 6) + 1; tw-- > 0;) {
+        bits = top_[tw];
+        if (tw == (k >> 6)) bits &= ~0ULL >> (63 - (k & 63));
+        if (bits) {
+            size_t mword = (tw << 6) + 63 - __builtin_clzll(bits);
+            size_t lw = (mword << 6) + 63 - __builtin_clzll(mid_[mword]);
+            return (lw << 6) + 63 - __builtin_clzll(leaf_[lw]);
+        }
+    }
+    return npos;
+}
+
+static uint32_t round_up_pow2(uint32_t n) {
+    uint32_t p = 64;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+PriceLadder::PriceLadder(int32_t centre, uint32_t ticks)
+        : base_(centre - static_cast<int32_t>(round_up_pow2(ticks) / 2)),
+          ticks_(round_up_pow2(ticks)),
+          levels_(ticks_),
+          hidden_(ticks_, 0),
+          occupied_(ticks_) {
+}
+
+bool PriceLadder::sane_price(int32_t price) {
+    return price > INT32_MIN + static_cast<int32_t>(MAX_LADDER_TICKS) &&
+           price < INT32_MAX - static_cast<int32_t>(MAX_LADDER_TICKS);
+}
+
+// how wide the band has to be to cover [lo, hi] - doubled from what it is until it does
+static uint64_t band_for(uint64_t ticks, int64_t lo, int64_t hi) {
+    while (static_cast<uint64_t>(hi - lo + 1) > ticks) ticks <<= 1;
+    return ticks;
+}
+
+bool PriceLadder::can_recentre(int32_t price) const {
+    if (!sane_price(price)) return false;
+    if (empty()) return true;
+    return band_for(ticks_, std::min<int64_t>(price, lowest()), std::max<int64_t>(price, highest())) <= MAX_LADDER_TICKS;
+}
+
+void PriceLadder::recentre(int32_t price) {
+    // the book checks fits() first, so these only go off if something else calls get_or_add blind
+    if (!sane_price(price)) {
+        throw std::runtime_error("Price outside ladder band!");
+    }
+    // empty ladder - nothing to move, just slide the band over
+    if (empty()) {
+        base_ = price - static_cast<int32_t>(ticks_ / 2);
+        return;
+    }
+
+    // the new band has to cover every occupied level plus the new price
+    int64_t lo = std::min<int64_t>(price, lowest());
+    int64_t hi = std::max<int64_t>(price, highest());
+    uint64_t new_ticks = band_for(ticks_, lo, hi);
+    if (new_ticks > MAX_LADDER_TICKS) {
+        throw std::runtime_error("Price outside ladder band!");
+    }
+
+    // centre on the new price where we can, but never cut off an occupied level
+    int64_t new_base = static_cast<int64_t>(price) - static_cast<int64_t>(new_ticks / 2);
+    new_base = std::min(new_base, lo);
+    new_base = std::max(new_base, hi - static_cast<int64_t>(new_ticks) + 1);
+
+    std::vector<PriceLevel> new_levels(new_ticks);
+    std::vector<uint64_t> new_hidden(new_ticks, 0);
+    OccupancyBitmap new_occupied(new_ticks);
+    for (int32_t p = lowest(); p != npos; p = next_higher(p)) {
+        size_t idx = static_cast<size_t>(p - new_base);
+        new_levels[idx] = std::move(levels_[p - base_]);
+        new_hidden[idx] = hidden_[p - base_];
+        new_occupied.set(idx);
+    }
+
+    base_ = static_cast<int32_t>(new_base);
+    ticks_ = static_cast<uint32_t>(new_ticks);
+    levels_ = std::move(new_levels);
+    hidden_ = std::move(new_hidden);
+    occupied_ = std::move(new_occupied);
+    if (indexed_) rebuild_index(); // every slot moved, so the tree has to be rebuilt from scratch
+}
+
+void PriceLadder::enable_index() {
+    indexed_ = true;
+    rebuild_index();
+}
+
+void PriceLadder::rebuild_index() {
+    std::vector<uint64_t> qty(ticks_, 0);
+    for (int32_t p = lowest(); p != npos; p = next_higher(p)) {
+        qty[p - base_] = tradable_qty(p);
+    }
+    index_.build(qty);
+}
+
+size_t PriceLadder::best_levels(bool from_top, int32_t* out, size_t n) const {
+    return collect_levels(from_top, from_top ? occupied_.find_prev(ticks_ - 1) : occupied_.find_next(0), out, n);
+}
+
+size_t PriceLadder::best_levels_after(bool from_top, int32_t after, int32_t* out, size_t n) const {
+    const int32_t p = from_top ? next_lower(after) : next_higher(after);
+    return p == npos ? 0 : collect_levels(from_top, static_cast<size_t>(p - base_), out, n);
+}
+
+// i is an occupied slot, or npos for none
+size_t PriceLadder::collect_levels(bool from_top, size_t i, int32_t* out, size_t n) const {
+    size_t found = 0;
+    while (i != OccupancyBitmap::npos && found < n) {
+        // everything left in i's word, in order, then one search for the next word with anything in
+        // it - unless that's all we wanted, since a search that comes up empty climbs all three levels
+        const size_t w = i >> 6;
+        uint64_t bits = occupied_.leaf_word(w);
+        if (from_top) {
+            bits &= ~0ULL >> (63 - (i & 63));
+            while (bits != 0 && found < n) {
+                const size_t b = 63 - static_cast<size_t>(__builtin_clzll(bits));
+                out[found++] = to_price((w << 6) + b);
+                bits &= ~(1ULL << b);
+            }
+            if (found == n || w == 0) break;
+            i = occupied_.find_prev((w << 6) - 1);
+        } else {
+            bits &= ~0ULL << (i & 63);
+            while (bits != 0 && found < n) {
+                out[found++] = to_price((w << 6) + static_cast<size_t>(__builtin_ctzll(bits)));
+                bits &= bits - 1;
+            }
+            if (found == n) break;
+            i = occupied_.find_next((w + 1) << 6);
+        }
+    }
+    return found;
+}
+
+uint64_t PriceLadder::total_qty() const {
+    if (indexed_) return index_.prefix(ticks_ - 1);
+    uint64_t sum = 0;
+    for (int32_t p = lowest(); p != npos; p = next_higher(p)) sum += tradable_qty(p);
+    return sum;
+}
+
+uint64_t PriceLadder::qty_at_or_below(int32_t price) const {
+    if (price < base_) return 0;
+    if (!in_band(price)) return total_qty();
+    if (indexed_) return index_.prefix(static_cast<size_t>(price - base_));
+
+    uint64_t sum = 0;
+    for (int32_t p = lowest(); p != npos && p <= price; p = next_higher(p)) sum += tradable_qty(p);
+    return sum;
+}
+
+uint64_t PriceLadder::qty_at_or_above(int32_t price) const {
+    if (price <= base_) return total_qty();
+    if (!in_band(price)) return 0;
+    if (indexed_) return total_qty() - index_.prefix(static_cast<size_t>(price - base_) - 1);
+
+    uint64_t sum = 0;
+    for (int32_t p = highest(); p != npos && p >= price; p = next_lower(p)) sum += tradable_qty(p);
+    return sum;
+}
+
+int32_t PriceLadder::sweep_up(uint64_t qty) const {
+    if (qty == 0) return lowest();
+    if (indexed_) {
+        // slots [0, c) hold at most qty-1, so slot c is where we reach qty
+        size_t c = index_.count_within(qty - 1);
+        return c < ticks_ ? base_ + static_cast<int32_t>(c) : npos;
+    }
+    uint64_t sum = 0;
+    for (int32_t p = lowest(); p != npos; p = next_higher(p)) {
+        sum += tradable_qty(p);
+        if (sum >= qty) return p;
+    }
+    return npos;
+}
+
+int32_t PriceLadder::sweep_down(uint64_t qty) const {
+    if (qty == 0) return highest();
+    if (indexed_) {
+        // the highest slot s with sum[s, end) >= qty is the one where sum[0, s) <= total - qty
+        uint64_t total = total_qty();
+        if (total < qty) return npos;
+        return base_ + static_cast<int32_t>(index_.count_within(total - qty));
+    }
+    uint64_t sum = 0;
+    for (int32_t p = highest(); p != npos; p = next_lower(p)) {
+        sum += tradable_qty(p);
+        if (sum >= qty) return p;
+    }
+    return npos;
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+// PriceLadder.h - one side of the book, stored as a flat array of price levels
+// instead of a std::map keyed by price, every tick in a band gets its own slot, so finding
+// the level for a price is just (price - base) - no tree walk, no node allocation.
+// a hierarchical occupancy bitmap sits on top so best price / next non-empty level are
+// found with a couple of bit-scan instructions instead of scanning empty slots.
+// OrderBook.h holds one of these for bids and one for asks.
+
+#include "Order.h"
+#include "FenwickTree.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// PriceLevel is an intrusive doubly-linked fifo threaded through the resting orders themselves
+// (Order::prev / Order::next). the level is just a head and a tail pointer, so:
+//   - push_back and pop_front are a couple of pointer writes
+//   - erasing from the middle (cancel) is O(1) too - no searching, nothing shifted behind it
+//   - there's no consumed prefix hanging around like the old vector + head index had
+// the orders come out of OrderPool, so the nodes never need allocating either
+// the level also keeps a running total of quantity and order count, so depth queries and the FOK
+// dry run can read a whole level in one go instead of walking every order in it
+struct PriceLevel {
+    Order*   head = nullptr; // oldest order - first in line to be matched
+    Order*   tail = nullptr; // newest order
+    uint64_t total_qty = 0;  // sum of quantity over every order in the queue
+    uint32_t count = 0;      // number of orders in the queue
+
+    bool   empty() const { return head == nullptr; }
+    Order* front() const { return head; }
+
+    void push_back(Order* o) {
+        o->prev = tail;
+        o->next = nullptr;
+        if (tail) tail->next = o; else head = o;
+        tail = o;
+        total_qty += o->quantity;
+        ++count;
+    }
+
+    // the front order has been filled down to zero - whatever it had was already taken off
+    // total_qty by fill(), so only the count changes here
+    void pop_front() {
+        head = head->next;
+        if (head) head->prev = nullptr; else tail = nullptr;
+        --count;
+    }
+
+    // some resting order at this level just traded qty
+    void fill(uint64_t qty) { total_qty -= qty; }
+
+    // unlink an order from anywhere in the queue, taking whatever quantity it had left with it
+    void erase(Order* o) {
+        if (o->prev) o->prev->next = o->next; else head = o->next;
+        if (o->next) o->next->prev = o->prev; else tail = o->prev;
+        total_qty -= o->quantity;
+        --count;
+    }
+
+    void clear() { head = tail = nullptr; total_qty = 0; count = 0; }
+
+    // walks head to tail so range-for still works for printing / the FOK dry run
+    // grabs next before handing out the order, so it's fine to unlink the current one mid-loop
+    struct iterator {
+        Order* cur;
+        Order* operator*() const { return cur; }
+        iterator& operator++() { cur = cur->next; return *this; }
+        bool operator!=(const iterator& other) const { return cur != other.cur; }
+    };
+    iterator begin() const { return {head}; }
+    iterator end()   const { return {nullptr}; }
+};
+
+// three-level bitmap - one bit per slot at the bottom, one bit per non-zero word above that,
+// and one bit per non-zero word above that again. a single 64-bit top word covers 262144 slots,
+// so any "find next set bit" is at most three bit-scans plus a couple of loads
+class OccupancyBitmap {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit OccupancyBitmap(size_t bits);
+
+    bool test(size_t i) const { return (leaf_[i >> 6] >> (i & 63)) & 1; }
+
+    void set(size_t i) {
+        leaf_[i >> 6]  |= 1ULL << (i & 63);
+        mid_[i >> 12]  |= 1ULL << ((i >> 6) & 63);
+        top_[i >> 18]  |= 1ULL << ((i >> 12) & 63);
+    }
+
+    // only walks up a level when the word below it has gone to zero
+    void clear(size_t i) {
+        if ((leaf_[i >> 6] &= ~(1ULL << (i & 63))) != 0) return;
+        if ((mid_[i >> 12] &= ~(1ULL << ((i >> 6) & 63))) != 0) return;
+        top_[i >> 18] &= ~(1ULL << ((i >> 12) & 63));
+    }
+
+    size_t find_next(size_t i) const; // first set bit >= i, or npos
+    size_t find_prev(size_t i) const; // last set bit <= i, or npos
+
+    uint64_t leaf_word(size_t w) const { return leaf_[w]; } // bits 64w - 64w+63
+    size_t size() const { return bits_; }
+
+private:
+    size_t bits_;
+    std::vector<uint64_t> leaf_;
+    std::vector<uint64_t> mid_;
+    std::vector<uint64_t> top_;
+};
+
+class PriceLadder {
+public:
+    // returned by the search functions when there's no occupied level in that direction
+    static constexpr int32_t npos = INT32_MIN;
+
+    // ticks is rounded up to a power of two, centre is where the band starts out
+    PriceLadder(int32_t centre, uint32_t ticks);
+
+    bool in_band(int32_t price) const {
+        return static_cast<uint64_t>(static_cast<int64_t>(price) - base_) < ticks_;
+    }
+    bool empty() const { return occupied_count_ == 0; }
+
+    // whether get_or_add(price) can take it - it's in the band, or recentre can stretch the band
+    // to it without passing the size cap. recentre throws otherwise, so the book asks this before
+    // it journals or matches anything that might rest
+    bool fits(int32_t price) const { return in_band(price) || can_recentre(price); }
+    bool can_recentre(int32_t price) const;
+    // far enough inside int32 that a band round it can't overflow - what an empty ladder can take
+    static bool sane_price(int32_t price);
+
+    // level for a price that's known to be occupied (e.g. the price of a resting order)
+    PriceLevel&       at(int32_t price)       { return levels_[price - base_]; }
+    const PriceLevel& at(int32_t price) const { return levels_[price - base_]; }
+
+    // level to append a resting order to - re-centres the band first if the price is outside it
+    PriceLevel& get_or_add(int32_t price) {
+        if (!in_band(price)) recentre(price);
+        size_t idx = static_cast<size_t>(price - base_);
+        if (!occupied_.test(idx)) {
+            occupied_.set(idx);
+            ++occupied_count_;
+        }
+        return levels_[idx];
+    }
+
+    // pull a level's cache line in ahead of time (batched submission) - no-op outside the band
+    void prefetch(int32_t price) const {
+        if (in_band(price)) __builtin_prefetch(&levels_[static_cast<size_t>(price - base_)], 1);
+    }
+    // the newest order at a level, if any - where a new order at that price gets linked in.
+    // only a prefetch hint, the level can be empty (or change) by the time it's used
+    const Order* tail_hint(int32_t price) const {
+        return in_band(price) ? levels_[static_cast<size_t>(price - base_)].tail : nullptr;
+    }
+
+    // called once a level has no live orders left
+    void erase(int32_t price) {
+        size_t idx = static_cast<size_t>(price - base_);
+        levels_[idx].clear();
+        occupied_.clear(idx);
+        --occupied_count_;
+    }
+
+    int32_t lowest()  const { return to_price(occupied_.find_next(0)); }
+    int32_t highest() const { return to_price(occupied_.find_prev(ticks_ - 1)); }
+
+    // next occupied level strictly above / below a price
+    int32_t next_higher(int32_t price) const {
+        if (price < base_) return lowest();
+        size_t idx = static_cast<size_t>(price - base_) + 1;
+        return idx >= ticks_ ? npos : to_price(occupied_.find_next(idx));
+    }
+    int32_t next_lower(int32_t price) const {
+        if (price <= base_) return npos;
+        int64_t idx = static_cast<int64_t>(price) - base_ - 1;
+        if (idx >= ticks_) return highest();
+        return to_price(occupied_.find_prev(static_cast<size_t>(idx)));
+    }
+
+    // the best `n` occupied prices into out, best first - highest down if from_top, lowest up
+    // otherwise. returns how many there were. same answer as a highest() / next_lower() walk, but
+    // the levels that share a bitmap word come out of it with bit tricks, one search per word
+    // rather than one per level - what the top-of-book publish does after every change
+    size_t best_levels(bool from_top, int32_t* out, size_t n) const;
+    // the same, carrying on from the occupied levels strictly behind `after` (below it if
+    // from_top) - the top of book rewalking a side from the first row that changed
+    size_t best_levels_after(bool from_top, int32_t after, int32_t* out, size_t n) const;
+
+    // shift (and if needed widen) the band so price fits, keeping every occupied level
+    void recentre(int32_t price);
+
+    // --- optional prefix-sum index over level quantities ---
+    // off by default because every quantity change then costs an O(log N) tree update.
+    // with it on, the range queries below are O(log N); with it off they walk the occupied levels
+    void enable_index();
+    bool indexed() const { return indexed_; }
+
+    // the book calls this every time a level's total_qty changes (rest, fill, cancel)
+    void index_add(int32_t price, int64_t delta) {
+        if (indexed_) index_.add(static_cast<size_t>(price - base_), delta);
+    }
+
+    // --- iceberg reserve ---
+    // what the icebergs at a level still hold back behind their displayed slices. it's not in
+    // PriceLevel::total_qty - depth, market data and the top of book show only what's displayed -
+    // but it trades: an order that takes a whole slice meets the next one straight away at the
+    // same price. so the quantity queries below and the FOK dry run count it, and the index covers
+    // it too. kept beside the levels rather than in PriceLevel so a level stays 32 bytes, two to a
+    // cache line - only icebergs write it. the book calls add_hidden when a reserve changes (rest,
+    // refill, cancel), always before the level is erased
+    uint64_t hidden_qty(int32_t price) const { return hidden_[static_cast<size_t>(price - base_)]; }
+    void add_hidden(int32_t price, int64_t delta) {
+        hidden_[static_cast<size_t>(price - base_)] += delta;
+        index_add(price, delta);
+    }
+    // all of a level that would trade - displayed and reserve
+    uint64_t tradable_qty(int32_t price) const {
+        const size_t idx = static_cast<size_t>(price - base_);
+        return levels_[idx].total_qty + hidden_[idx];
+    }
+
+    // these count tradable quantity, reserve included
+    uint64_t total_qty() const;
+    uint64_t qty_at_or_below(int32_t price) const; // everything resting at prices <= price
+    uint64_t qty_at_or_above(int32_t price) const; // everything resting at prices >= price
+
+    // price of the level where the cumulative quantity first reaches qty, walking up from the
+    // lowest level / down from the highest. npos if the whole side doesn't add up to qty
+    int32_t sweep_up(uint64_t qty) const;
+    int32_t sweep_down(uint64_t qty) const;
+
+    int32_t  base()  const { return base_; }
+    uint32_t ticks() const { return ticks_; }
+
+private:
+    int32_t base_;   // price of slot 0
+    uint32_t ticks_; // number of slots, always a power of two
+    size_t occupied_count_ = 0;
+    std::vector<PriceLevel> levels_;
+    std::vector<uint64_t> hidden_; // hidden_[i] goes with levels_[i] - 0 unless icebergs rest there
+    OccupancyBitmap occupied_;
+
+    bool indexed_ = false;
+    FenwickTree index_; // slot i = tradable_qty of levels_[i], only maintained while indexed_
+
+    void rebuild_index();
+    size_t collect_levels(bool from_top, size_t i, int32_t* out, size_t n) const; // from slot i on
+
+    int32_t to_price(size_t idx) const {
+        return idx == OccupancyBitmap::npos ? npos : base_ + static_cast<int32_t>(idx);
+    }
+};
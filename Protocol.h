@@ -0,0 +1,128 @@
+#pragma once
+
+// Protocol.h - the binary order-entry protocol (loosely modelled on OUCH)
+// every message is a fixed-layout little-endian struct whose first byte is its type, so a decoder
+// can read it straight out of the receive buffer / mapped file - no parsing, no copying into a
+// separate decoded struct. layouts only use naturally aligned fields and every message is a
+// multiple of 8 bytes, so as long as the buffer starts 8-byte aligned (mmap and new[] both are)
+// every message in it is aligned too.
+//
+// inbound:  NewOrderMsg 'O', CancelMsg 'X', ReplaceMsg 'U'
+// outbound: ExecReportMsg 'E' (one per inbound message), TradeReportMsg 'T' (one per fill)
+// ProtocolDecoder.h has the decoder that feeds these into an OrderBook.
+
+#include "Order.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+enum class MsgType : uint8_t {
+    NewOrder    = 'O',
+    Cancel      = 'X',
+    Replace     = 'U',
+    ExecReport  = 'E',
+    TradeReport = 'T'
+};
+
+struct NewOrderMsg {
+    MsgType   type;       // 'O'
+    OrderSide side;
+    OrderType order_type;
+    uint8_t   reserved0;
+    int32_t   price;      // ticks, > 0 - ignored for Market
+    uint64_t  client_order_id;
+    uint32_t  quantity;
+    uint32_t  reserved1;
+};
+
+struct CancelMsg {
+    MsgType  type;        // 'X'
+    uint8_t  reserved[7];
+    uint64_t order_id;    // the ID from the ExecReport that said Resting
+};
+
+// amends a resting order in place via OrderBook::modify_order - it keeps its order ID, and keeps
+// its queue position if the price is unchanged and the quantity only goes down
+struct ReplaceMsg {
+    MsgType   type;       // 'U'
+    OrderSide side;       // ignored by the book, which knows the order's side - still has to be Buy / Sell
+    uint8_t   reserved0[2];
+    int32_t   new_price;
+    uint64_t  order_id;
+    uint32_t  new_quantity;
+    uint32_t  reserved1;
+};
+
+struct ExecReportMsg {
+    MsgType  type;        // 'E'
+    MsgType  in_reply_to; // which inbound message this answers
+    uint8_t  status;      // OrderStatus
+    uint8_t  reserved[5];
+    uint64_t client_order_id; // echoed back from NewOrderMsg. cancel / replace: the one the order
+                              // rested with (OrderBook::client_order_id), 0 if it wasn't resting
+    uint64_t order_id;        // new order: its ID (0 if it didn't rest), cancel / replace: the order it was for
+};
+
+struct TradeReportMsg {
+    MsgType  type;        // 'T'
+    uint8_t  reserved[3];
+    int32_t  price;
+    uint64_t buyer_order_id;
+    uint64_t seller_order_id;
+    uint64_t quantity;
+};
+
+static_assert(sizeof(NewOrderMsg)    == 24, "wire layout changed");
+static_assert(sizeof(CancelMsg)      == 16, "wire layout changed");
+static_assert(sizeof(ReplaceMsg)     == 24, "wire layout changed");
+static_assert(sizeof(ExecReportMsg)  == 24, "wire layout changed");
+static_assert(sizeof(TradeReportMsg) == 32, "wire layout changed");
+
+// size of a message from its type byte, 0 if the type isn't one we know
+inline size_t message_size(MsgType type) {
+    switch (type) {
+        case MsgType::NewOrder:    return sizeof(NewOrderMsg);
+        case MsgType::Cancel:      return sizeof(CancelMsg);
+        case MsgType::Replace:     return sizeof(ReplaceMsg);
+        case MsgType::ExecReport:  return sizeof(ExecReportMsg);
+        case MsgType::TradeReport: return sizeof(TradeReportMsg);
+    }
+    return 0;
+}
+
+// helpers for building an inbound stream (capture files, tests, benchmarks) - not on the hot path
+template <typename Msg>
+inline void append_message(std::vector<uint8_t>& out, const Msg& msg) {
+    size_t at = out.size();
+    out.resize(at + sizeof(Msg));
+    std::memcpy(out.data() + at, &msg, sizeof(Msg));
+}
+
+inline void append_new_order(std::vector<uint8_t>& out, const Order& o, uint64_t client_order_id) {
+    NewOrderMsg m{};
+    m.type = MsgType::NewOrder;
+    m.side = o.side;
+    m.order_type = o.type;
+    m.price = o.price;
+    m.client_order_id = client_order_id;
+    m.quantity = static_cast<uint32_t>(o.quantity);
+    append_message(out, m);
+}
+
+inline void append_cancel(std::vector<uint8_t>& out, uint64_t order_id) {
+    CancelMsg m{};
+    m.type = MsgType::Cancel;
+    m.order_id = order_id;
+    append_message(out, m);
+}
+
+inline void append_replace(std::vector<uint8_t>& out, uint64_t order_id, OrderSide side,
+                           int32_t new_price, uint32_t new_quantity) {
+    ReplaceMsg m{};
+    m.type = MsgType::Replace;
+    m.side = side;
+    m.new_price = new_price;
+    m.order_id = order_id;
+    m.new_quantity = new_quantity;
+    append_message(out, m);
+}
@@ -0,0 +1,107 @@
+#include "ProtocolDecoder.h"
+#include <stdexcept>
+
+// ProtocolDecoder.cpp - the decode loop and the report encoders
+// see Protocol.h for the message layouts and ProtocolDecoder.h for the buffering rules
+
+ProtocolDecoder::ProtocolDecoder(OrderBook& book, ReportBuffer& reports, size_t report_headroom)
+        : book_(book), reports_(reports), report_headroom_(report_headroom) {
+}
+
+size_t ProtocolDecoder::decode(const uint8_t* data, size_t len) {
+    size_t pos = 0;
+    while (pos < len && reports_.remaining() >= report_headroom_) {
+        // the type byte is all we need to know how big the message is
+        const MsgType type = static_cast<MsgType>(data[pos]);
+        const size_t size = message_size(type);
+        if (size == 0) {
+            throw std::runtime_error("Unknown message type in order-entry stream!");
+        }
+        if (len - pos < size) break; // partial message at the end - wait for the rest
+
+        // the message is read where it sits - see the alignment note at the top of Protocol.h
+        const uint8_t* msg = data + pos;
+        switch (type) {
+            case MsgType::NewOrder: on_new_order(*reinterpret_cast<const NewOrderMsg*>(msg)); break;
+            case MsgType::Cancel:   on_cancel(*reinterpret_cast<const CancelMsg*>(msg));      break;
+            case MsgType::Replace:  on_replace(*reinterpret_cast<const ReplaceMsg*>(msg));    break;
+            default:
+                throw std::runtime_error("Outbound message type in order-entry stream!");
+        }
+        ++stats_.messages;
+        pos += size;
+    }
+    return pos;
+}
+
+// the enum fields come straight off the wire, so a corrupt byte would otherwise turn into a side
+// or type the book's dispatch quietly treats as one of the real ones. compared as raw bytes since
+// an out-of-range enum value is exactly what we're looking for. Iceberg isn't valid here - it
+// needs a display size, which NewOrderMsg doesn't carry
+static bool valid_side(OrderSide side) {
+    return static_cast<uint8_t>(side) <= static_cast<uint8_t>(OrderSide::Sell);
+}
+
+static bool valid_new_order(const NewOrderMsg& m) {
+    if (!valid_side(m.side)) return false;
+    if (static_cast<uint8_t>(m.order_type) > static_cast<uint8_t>(OrderType::FOK)) return false;
+    return m.order_type == OrderType::Market || m.price > 0;
+}
+
+void ProtocolDecoder::on_new_order(const NewOrderMsg& m) {
+    ++stats_.new_orders;
+    if (!valid_new_order(m)) [[unlikely]] {
+        ++stats_.malformed;
+        report(MsgType::NewOrder, OrderStatus::Rejected, m.client_order_id, 0);
+        return;
+    }
+    auto result = book_.process_order(Order(m.side, m.order_type, m.price, m.quantity));
+    // the book keeps the client ID only while the order rests - that's when a cancel / replace can ask for it
+    if (result.new_order_id != 0 && m.client_order_id != 0) book_.set_client_order_id(result.new_order_id, m.client_order_id);
+    report_trades(result);
+    report(MsgType::NewOrder, result.status, m.client_order_id, result.new_order_id);
+}
+
+void ProtocolDecoder::on_cancel(const CancelMsg& m) {
+    ++stats_.cancels;
+    const uint64_t client_order_id = book_.client_order_id(m.order_id); // read before the order goes
+    bool ok = book_.cancel_order(m.order_id);
+    report(MsgType::Cancel, ok ? OrderStatus::Cancelled : OrderStatus::Rejected, client_order_id, m.order_id);
+}
+
+void ProtocolDecoder::on_replace(const ReplaceMsg& m) {
+    ++stats_.replaces;
+    if (!valid_side(m.side) || m.new_price <= 0) [[unlikely]] {
+        ++stats_.malformed;
+        report(MsgType::Replace, OrderStatus::Rejected, 0, m.order_id);
+        return;
+    }
+    const uint64_t client_order_id = book_.client_order_id(m.order_id); // gone if the replace fills it
+    auto result = book_.modify_order(m.order_id, m.new_price, m.new_quantity);
+    report_trades(result);
+    report(MsgType::Replace, result.status, client_order_id, m.order_id);
+}
+
+void ProtocolDecoder::report(MsgType in_reply_to, OrderStatus status, uint64_t client_order_id,
+                             uint64_t order_id) {
+    ExecReportMsg* r = reports_.next<ExecReportMsg>();
+    if (!r) {
+        ++stats_.dropped_reports;
+        return;
+    }
+    *r = ExecReportMsg{MsgType::ExecReport, in_reply_to, static_cast<uint8_t>(status), {},
+                       client_order_id, order_id};
+}
+
+void ProtocolDecoder::report_trades(const ProcessOrderResult& result) {
+    stats_.trades += result.trades.size();
+    for (const Trade& t : result.trades) {
+        TradeReportMsg* r = reports_.next<TradeReportMsg>();
+        if (!r) {
+            ++stats_.dropped_reports;
+            continue;
+        }
+        *r = TradeReportMsg{MsgType::TradeReport, {}, t.price, t.buyer_order_id, t.seller_order_id,
+                            t.quantity};
+    }
+}
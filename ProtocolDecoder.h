@@ -0,0 +1,84 @@
+#pragma once
+
+// ProtocolDecoder.h - feeds binary protocol messages (Protocol.h) into an OrderBook
+// the decoder walks a contiguous byte buffer (socket receive buffer, mapped capture file, ...)
+// and dispatches each message in place - the fields are read straight off the buffer, nothing is
+// allocated per message. replies get encoded the same way into a preallocated ReportBuffer.
+// one decode() call handles a whole batch, so the per-call overhead is paid once per buffer.
+
+#include "OrderBook.h"
+#include "Protocol.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// fixed-size output buffer for ExecReport / TradeReport messages
+// the backing store is uint64_t so the start is 8-byte aligned, same rule as the inbound side
+class ReportBuffer {
+public:
+    explicit ReportBuffer(size_t capacity_bytes)
+            : storage_(new uint64_t[(capacity_bytes + 7) / 8]),
+              capacity_((capacity_bytes + 7) / 8 * 8) {}
+
+    const uint8_t* data()      const { return reinterpret_cast<const uint8_t*>(storage_.get()); }
+    size_t         size()      const { return size_; }
+    size_t         remaining() const { return capacity_ - size_; }
+
+    // caller has sent / copied the reports somewhere - start writing from the front again
+    void clear() { size_ = 0; }
+
+    // hands out the next sizeof(Msg) bytes to write a message into, nullptr if it doesn't fit
+    template <typename Msg>
+    Msg* next() {
+        if (remaining() < sizeof(Msg)) return nullptr;
+        Msg* m = reinterpret_cast<Msg*>(reinterpret_cast<uint8_t*>(storage_.get()) + size_);
+        size_ += sizeof(Msg);
+        return m;
+    }
+
+private:
+    std::unique_ptr<uint64_t[]> storage_;
+    size_t capacity_;
+    size_t size_ = 0;
+};
+
+struct DecodeStats {
+    uint64_t messages        = 0;
+    uint64_t new_orders      = 0;
+    uint64_t cancels         = 0;
+    uint64_t replaces        = 0;
+    uint64_t trades          = 0;
+    uint64_t malformed       = 0; // side / order type / price byte out of range - answered Rejected
+    uint64_t dropped_reports = 0; // reports that didn't fit in the ReportBuffer - should stay 0
+};
+
+class ProtocolDecoder {
+public:
+    // report_headroom: decode() stops before the next message once the ReportBuffer has less than
+    // this many bytes free, so the caller can drain it. a single message can still produce more
+    // reports than that (a huge sweep) - anything that doesn't fit is counted in dropped_reports
+    ProtocolDecoder(OrderBook& book, ReportBuffer& reports, size_t report_headroom = 64 * 1024);
+
+    // decode + apply every whole message in [data, data + len)
+    // returns how many bytes were consumed - less than len if the buffer ends part-way through a
+    // message or the report buffer needs draining. throws on a type byte it doesn't recognise.
+    // a message that parses but carries a side or order type outside its enum, or a non-positive
+    // price on a priced order, never reaches the book - it's counted in malformed and answered
+    // with a Rejected ExecReport
+    size_t decode(const uint8_t* data, size_t len);
+
+    const DecodeStats& stats() const { return stats_; }
+
+private:
+    OrderBook& book_;
+    ReportBuffer& reports_;
+    size_t report_headroom_;
+    DecodeStats stats_;
+
+    void on_new_order(const NewOrderMsg& m);
+    void on_cancel(const CancelMsg& m);
+    void on_replace(const ReplaceMsg& m);
+
+    void report(MsgType in_reply_to, OrderStatus status, uint64_t client_order_id, uint64_t order_id);
+    void report_trades(const ProcessOrderResult& result);
+};
@@ -0,0 +1,164 @@
+#include "ReplayRunner.h"
+#include "WaitStrategy.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+// ReplayRunner.cpp - the worker pool and its job deques, see ReplayRunner.h
+
+namespace {
+
+// one worker's jobs, as indexes into the path list - aligned so two workers' locks never share a line
+struct alignas(CACHE_LINE) JobDeque {
+    std::mutex lock;
+    std::deque<size_t> jobs;
+
+    // the owner - its biggest job left
+    bool pop_back(size_t& job) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (jobs.empty()) return false;
+        job = jobs.back();
+        jobs.pop_back();
+        return true;
+    }
+
+    // anyone else - the smallest, the one the owner would have got to last
+    bool steal_front(size_t& job) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (jobs.empty()) return false;
+        job = jobs.front();
+        jobs.pop_front();
+        return true;
+    }
+};
+
+void add_stats(ReplayStats& total, const ReplayStats& s) {
+    total.records       += s.records;
+    total.new_orders    += s.new_orders;
+    total.cancels       += s.cancels;
+    total.modifies      += s.modifies;
+    total.stops         += s.stops;
+    total.icebergs      += s.icebergs;
+    total.auctions      += s.auctions;
+    total.expired       += s.expired;
+    total.mass_cancelled += s.mass_cancelled;
+    total.trades        += s.trades;
+    total.id_mismatches += s.id_mismatches;
+}
+
+} // namespace
+
+ReplayRunner::ReplayRunner(const ReplayRunnerConfig& config) : config_(config) {
+    if (!config_.book.trade_log_path.empty()) {
+        throw std::invalid_argument("ReplayRunner books can't spill trades to a file");
+    }
+    threads_ = config_.threads ? config_.threads : std::max(1u, std::thread::hardware_concurrency());
+    books_.resize(threads_);
+}
+
+ReplayRunner::~ReplayRunner() {
+}
+
+ReplayReport ReplayRunner::run_directory(const std::string& dir) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec)) {
+        throw std::runtime_error(dir + " is not a directory!");
+    }
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".jrnl") paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return run(paths);
+}
+
+ReplayReport ReplayRunner::run(const std::vector<std::string>& paths) {
+    ReplayReport report;
+    report.threads = threads_;
+    report.jobs.resize(paths.size());
+    if (paths.empty()) return report;
+
+    // biggest first, so the long jobs start straight away and the short ones fill in round them
+    // at the end. a file that can't be sized sorts last and fails properly when its job runs
+    std::vector<uintmax_t> sizes(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        std::error_code ec;
+        sizes[i] = std::filesystem::file_size(paths[i], ec);
+        if (ec) sizes[i] = 0;
+    }
+    std::vector<size_t> order(paths.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    // dealt round-robin smallest first, so every deque ends up with its biggest job at the back
+    std::vector<JobDeque> deques(threads_);
+    for (size_t rank = order.size(); rank-- > 0;) deques[rank % threads_].jobs.push_back(order[rank]);
+
+    std::atomic<uint32_t> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> steals{0};
+
+    auto worker = [&](uint32_t w) {
+        if (config_.pin_threads) pin_this_thread(config_.first_core + w);
+        if (!books_[w]) books_[w] = std::make_unique<OrderBook>(config_.book);
+        OrderBook& book = *books_[w];
+
+        // nobody starts until every book exists, so building them isn't in the timing
+        ready.fetch_add(1, std::memory_order_release);
+        while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+        uint64_t stolen = 0;
+        auto steal = [&](size_t& job) {
+            for (uint32_t i = 1; i < threads_; ++i) {
+                if (deques[(w + i) % threads_].steal_front(job)) {
+                    ++stolen;
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        size_t job;
+        while (deques[w].pop_back(job) || steal(job)) {
+            ReplayJobResult& r = report.jobs[job]; // only this worker touches this slot
+            r.path = paths[job];
+            r.worker = w;
+            auto start = std::chrono::steady_clock::now();
+            try {
+                r.stats = replay_journal(paths[job], book);
+            } catch (const std::exception& e) {
+                r.error = e.what();
+            }
+            r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            r.best_bid = book.get_best_bid();
+            r.best_ask = book.get_best_ask();
+            book.reset();
+        }
+        steals.fetch_add(stolen, std::memory_order_relaxed);
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads_);
+    for (uint32_t w = 0; w < threads_; ++w) pool.emplace_back(worker, w);
+    while (ready.load(std::memory_order_acquire) < threads_) std::this_thread::yield();
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : pool) t.join();
+    report.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    report.steals = steals.load(std::memory_order_relaxed);
+    for (const ReplayJobResult& r : report.jobs) {
+        add_stats(report.totals, r.stats);
+        report.busy_seconds += r.seconds;
+        if (!r.error.empty()) ++report.failed;
+    }
+    return report;
+}
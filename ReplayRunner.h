@@ -0,0 +1,83 @@
+#pragma once
+
+// ReplayRunner.h - replays a directory of journals (one per symbol-day) through independent books
+// on a pool of worker threads, for backtesting / research runs over lots of history at once.
+// every journal is its own job: a worker takes one, replays it start to finish into its book with
+// replay_journal() (the file is memory-mapped, nothing is copied), records how it went, resets
+// the book and takes the next. jobs never share a book, so nothing on the replay path locks.
+//
+// each worker builds one book on its own thread (so the memory is first-touched on its core) and
+// keeps it: OrderBook::reset() hands the orders back to the pool and keeps every page it has
+// mapped, so the 2nd to 1000th job on a worker cost nothing to set up - not a fresh ~140 MB book
+// each. the books outlive run() too, a second run() on the same runner reuses them again.
+//
+// scheduling is work stealing. jobs are sorted biggest file first and dealt round-robin into a
+// deque per worker. a worker takes its own biggest remaining job from the back; once its deque is
+// empty it steals from the front of someone else's (their smallest - the one they'd have got to
+// last). a job is a whole file, thousands to millions of records, so a plain mutex per deque is
+// nowhere near hot enough to be worth a lock-free deque - it's taken once per job, not per record
+
+#include "OrderBook.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ReplayRunnerConfig {
+    uint32_t threads     = 0;     // workers - 0 is one per core (std::thread::hardware_concurrency)
+    bool     pin_threads = false; // pin worker i to core (first_core + i)
+    uint32_t first_core  = 0;
+
+    // every worker's book. trade_log_path has to stay empty - reset() can't rewind a trade file,
+    // and one file per book wouldn't say which job a trade came from anyway
+    OrderBookConfig book;
+};
+
+// how one journal went
+struct ReplayJobResult {
+    std::string path;
+    ReplayStats stats;        // records by type, trades - see Journal.h
+    double   seconds  = 0;    // replay only - the book reset after it isn't counted
+    uint32_t worker   = 0;    // which worker ran it
+    int32_t  best_bid = 0;    // where the book finished (ticks, 0 if that side was empty)
+    int32_t  best_ask = 0;
+    std::string error;        // what replay_journal threw, if it did - the other jobs still run
+
+    double msgs_per_sec() const { return seconds > 0 ? stats.records / seconds : 0; }
+};
+
+struct ReplayReport {
+    std::vector<ReplayJobResult> jobs; // same order as the paths run() was given
+    ReplayStats totals;                // every job's stats added up
+    double   wall_seconds = 0;         // every worker has its book -> the last job finishes
+    double   busy_seconds = 0;         // every job's seconds added up
+    uint32_t threads = 0;
+    uint64_t steals  = 0;              // jobs a worker took off another worker's deque
+    size_t   failed  = 0;              // jobs with an error
+
+    // aggregate throughput - every record replayed over the wall time
+    double msgs_per_sec() const { return wall_seconds > 0 ? totals.records / wall_seconds : 0; }
+};
+
+class ReplayRunner {
+public:
+    explicit ReplayRunner(const ReplayRunnerConfig& config = ReplayRunnerConfig{});
+    ~ReplayRunner();
+
+    ReplayRunner(const ReplayRunner&) = delete;
+    ReplayRunner& operator=(const ReplayRunner&) = delete;
+
+    // every *.jrnl file in dir (not recursive), in name order. throws std::runtime_error if dir
+    // isn't a directory
+    ReplayReport run_directory(const std::string& dir);
+
+    // the given journals. blocks until every one has been replayed
+    ReplayReport run(const std::vector<std::string>& paths);
+
+    uint32_t threads() const { return threads_; }
+
+private:
+    ReplayRunnerConfig config_;
+    uint32_t threads_;
+    std::vector<std::unique_ptr<OrderBook>> books_; // one per worker, built by the worker on first use
+};
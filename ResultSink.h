@@ -0,0 +1,61 @@
+#pragma once
+
+// ResultSink.h - where OrderBook::process_orders / process_commands put their results
+// one BatchResult per input message, in the order they came in, plus every trade the whole batch
+// generated in one contiguous array. a result points at its trades by offset rather than into the
+// book's own buffers, so the whole batch can be read (or encoded into reports) after the call
+// returns. keep one sink and reuse it - clear() keeps the capacity, so steady state never allocates
+
+#include "Trade.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+enum class OrderStatus : uint8_t; // OrderBook.h
+
+struct BatchResult {
+    uint64_t    order_id;    // New: the order's ID if it's resting (0 if not), Cancel / Modify: the order it was for,
+                             // Clock: how many orders it expired (the market data feed has a delete for each)
+                             // MassCancel: how many orders it cancelled (the same)
+    uint32_t    first_trade; // where this message's trades start in ResultSink::trades()
+    uint32_t    num_trades;
+    OrderStatus status;
+};
+
+class ResultSink {
+public:
+    explicit ResultSink(size_t max_batch = 1024, size_t max_trades = 8192) {
+        results_.reserve(max_batch);
+        trades_.reserve(max_trades);
+    }
+
+    void clear() {
+        results_.clear();
+        trades_.clear();
+    }
+
+    size_t size() const { return results_.size(); }
+    const BatchResult& operator[](size_t i) const { return results_[i]; }
+
+    std::span<const BatchResult> results() const { return results_; }
+    std::span<const Trade> trades() const { return trades_; } // every trade in the batch, in order
+    std::span<const Trade> trades(const BatchResult& r) const {
+        return {trades_.data() + r.first_trade, r.num_trades};
+    }
+
+private:
+    friend class OrderBook;
+
+    std::vector<BatchResult> results_;
+    std::vector<Trade> trades_;
+
+    // kept small enough to inline into the batch loops - the trade copy (most messages have no
+    // trades) and the vectors' regrow paths stay out of line
+    void add(uint64_t order_id, OrderStatus status, std::span<const Trade> trades) {
+        results_.push_back({order_id, static_cast<uint32_t>(trades_.size()),
+                            static_cast<uint32_t>(trades.size()), status});
+        if (!trades.empty()) add_trades(trades);
+    }
+    void add_trades(std::span<const Trade> trades);
+};
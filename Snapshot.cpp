@@ -0,0 +1,322 @@
+#include "OrderBook.h"
+#include "Snapshot.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Snapshot.cpp - OrderBook::save_snapshot / save_snapshot_async / load_snapshot
+// see Snapshot.h for the file layout. the writer has to be safe to run in a forked child of a
+// multi-threaded process (the trade log and journal have threads of their own), so it sticks to
+// raw syscalls and a buffer the parent allocated - no malloc, no iostreams, no exceptions.
+
+static constexpr size_t SNAPSHOT_BUF = 1 << 20;
+static constexpr uint32_t PREFETCH_AHEAD = 8; // orders ahead the loader prefetches lookup slots for
+
+namespace {
+
+// buffered write() straight to an fd
+struct FdWriter {
+    int fd;
+    uint8_t* buf;
+    size_t n = 0;
+    bool ok = true;
+
+    void put(const void* p, size_t len) {
+        if (n + len > SNAPSHOT_BUF) flush();
+        std::memcpy(buf + n, p, len);
+        n += len;
+    }
+
+    void flush() {
+        size_t off = 0;
+        while (ok && off < n) {
+            ssize_t w = ::write(fd, buf + off, n - off);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                ok = false;
+            } else {
+                off += static_cast<size_t>(w);
+            }
+        }
+        n = 0;
+    }
+};
+
+} // namespace
+
+bool OrderBook::write_snapshot_file(const char* tmp_path, const char* path, uint8_t* buf) const {
+    // first pass over the levels only (per-level counts) to fill in the header
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+    header.next_order_id = next_order_id_;
+    header.journal_seq   = journal_ ? journal_->count() : 0;
+    header.pool_capacity = static_cast<uint32_t>(std::min<size_t>(order_pool_.capacity(), UINT32_MAX));
+    header.flags         = auction_ ? SNAPSHOT_IN_AUCTION : 0;
+    // the clock block is only written once the book has a clock, so files stay as they were without one
+    const bool has_clock = expiries_ || clock_ != 0 || day_close_ != 0;
+    if (has_clock) header.flags |= SNAPSHOT_EXPIRIES;
+    if (owners_) header.flags |= SNAPSHOT_OWNERS;
+    for (int32_t p = bids_.highest(); p != PriceLadder::npos; p = bids_.next_lower(p)) {
+        ++header.levels;
+        header.orders += bids_.at(p).count;
+    }
+    header.bid_levels = static_cast<uint32_t>(header.levels);
+    for (int32_t p = asks_.lowest(); p != PriceLadder::npos; p = asks_.next_higher(p)) {
+        ++header.levels;
+        header.orders += asks_.at(p).count;
+    }
+    header.stops = pending_stops();
+    header.icebergs = static_cast<uint32_t>(icebergs_.in_use());
+
+    int fd = ::open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    FdWriter out{fd, buf};
+    out.put(&header, sizeof(header));
+
+    auto put_level = [&](int32_t price, const PriceLevel& level) {
+        SnapshotLevel l{price, level.count};
+        out.put(&l, sizeof(l));
+        for (const Order* o : level) {
+            SnapshotOrder so{o->order_id, o->quantity};
+            out.put(&so, sizeof(so));
+        }
+    };
+    for (int32_t p = bids_.highest(); p != PriceLadder::npos; p = bids_.next_lower(p)) put_level(p, bids_.at(p));
+    for (int32_t p = asks_.lowest(); p != PriceLadder::npos; p = asks_.next_higher(p)) put_level(p, asks_.at(p));
+    if (stops_) {
+        stops_->for_each([&](const StopOrder& s) {
+            SnapshotStop ss{s.order.order_id, s.order.quantity, s.trigger, s.order.price, s.order.side, s.order.type, {}};
+            out.put(&ss, sizeof(ss));
+        });
+    }
+    if (header.icebergs > 0) {
+        // second walk over the orders, same order as above
+        auto put_icebergs = [&](const PriceLevel& level) {
+            for (const Order* o : level) {
+                if (o->type != OrderType::Iceberg) continue;
+                const IcebergOrder* ice = as_iceberg(o);
+                SnapshotIceberg si{o->order_id, ice->hidden, static_cast<uint32_t>(ice->display), 0};
+                out.put(&si, sizeof(si));
+            }
+        };
+        for (int32_t p = bids_.highest(); p != PriceLadder::npos; p = bids_.next_lower(p)) put_icebergs(bids_.at(p));
+        for (int32_t p = asks_.lowest(); p != PriceLadder::npos; p = asks_.next_higher(p)) put_icebergs(asks_.at(p));
+    }
+    if (has_clock) {
+        // two passes over the wheel - the count goes first, and the wheel still holds entries
+        // for orders that have gone since, which aren't written
+        SnapshotClock clock{clock_, day_close_, 0, 0};
+        if (expiries_) {
+            expiries_->for_each([&](uint64_t id, uint64_t) { clock.expiries += order_lookup_.find(id) != nullptr; });
+        }
+        out.put(&clock, sizeof(clock));
+        if (expiries_) {
+            expiries_->for_each([&](uint64_t id, uint64_t tick) {
+                if (order_lookup_.find(id) == nullptr) return;
+                SnapshotExpiry se{id, tick * expiry_resolution_};
+                out.put(&se, sizeof(se));
+            });
+        }
+    }
+    if (owners_) {
+        // same two passes, straight down every owner's lanes - only live orders are on them. each
+        // lane goes out oldest first, so tagging them back in this order rebuilds the same lanes
+        auto for_each_owned = [&](auto&& f) {
+            owners_->for_each([&](const OwnerList& list) {
+                for (size_t s = 0; s < 2; ++s) {
+                    for (size_t l = 0; l < OwnerList::LANES; ++l) {
+                        for (Order* o = list.resting[s][l].head; o != nullptr; o = cold(o).owner_next) f(list.owner, o);
+                        for (Order* o = list.stops[s][l].head; o != nullptr; o = stop_cold(o).owner_next) f(list.owner, o);
+                    }
+                }
+            });
+        };
+        SnapshotOwners owners{0, 0};
+        for_each_owned([&](uint32_t, const Order*) { ++owners.count; });
+        out.put(&owners, sizeof(owners));
+        for_each_owned([&](uint32_t owner, const Order* o) {
+            SnapshotOwner so{o->order_id, owner, 0};
+            out.put(&so, sizeof(so));
+        });
+    }
+    out.flush();
+
+    // write to a temp file and rename over the old one, so a crash mid-write never leaves a
+    // half-written file where the last good snapshot used to be
+    bool ok = out.ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    return ok && ::rename(tmp_path, path) == 0;
+}
+
+void OrderBook::save_snapshot(const std::string& path) const {
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[SNAPSHOT_BUF]);
+    if (!write_snapshot_file((path + ".tmp").c_str(), path.c_str(), buf.get())) {
+        throw std::runtime_error("Could not write snapshot " + path + "!");
+    }
+}
+
+int OrderBook::save_snapshot_async(const std::string& path) const {
+    // everything the child needs is set up before the fork
+    std::string tmp = path + ".tmp";
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[SNAPSHOT_BUF]);
+
+    // the child gets a copy-on-write view of the book frozen at this instant. the parent's
+    // only stall is fork() itself (copying page tables) plus a page copy the first time it
+    // writes to each page the child still shares
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        throw std::runtime_error("Could not fork snapshot writer!");
+    }
+    if (pid == 0) {
+        bool ok = write_snapshot_file(tmp.c_str(), path.c_str(), buf.get());
+        ::_exit(ok ? 0 : 1);
+    }
+    return pid;
+}
+
+bool OrderBook::wait_snapshot(int pid) {
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+uint64_t OrderBook::load_snapshot(const std::string& path) {
+    if (next_order_id_ != 1 || !bids_.empty() || !asks_.empty() || pending_stops() != 0) {
+        throw std::runtime_error("Snapshot can only be loaded into a fresh book!");
+    }
+
+    MappedFile file(path);
+    if (file.size() < sizeof(SnapshotHeader)) {
+        throw std::runtime_error(path + " is not a snapshot!");
+    }
+    const SnapshotHeader& header = *reinterpret_cast<const SnapshotHeader*>(file.data());
+    // the header layout changed between versions, so nothing past the magic means anything in a
+    // file with another one
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, 8) != 0) {
+        const bool other_version = std::memcmp(header.magic, SNAPSHOT_MAGIC, 6) == 0;
+        throw std::runtime_error(path + (other_version ? " is a snapshot from another format version!"
+                                                       : " is not a snapshot!"));
+    }
+    const uint64_t book_bytes = sizeof(SnapshotHeader) + header.levels * sizeof(SnapshotLevel)
+                                                      + header.orders * sizeof(SnapshotOrder)
+                                                      + header.stops * sizeof(SnapshotStop)
+                                                      + header.icebergs * sizeof(SnapshotIceberg);
+    // the optional blocks after the book, each only if its flag is set - `take` hands out the next
+    // `count` records of `size` bytes, or nullptr if the file is too short for them
+    uint64_t offset = book_bytes;
+    auto take = [&](uint64_t count, size_t size) -> const uint8_t* {
+        if (offset > file.size() || count > (file.size() - offset) / size) return nullptr;
+        const uint8_t* at = file.data() + offset;
+        offset += count * size;
+        return at;
+    };
+    bool ok = true;
+    const SnapshotClock* clock = nullptr;
+    const SnapshotExpiry* expiries = nullptr;
+    if (ok && (header.flags & SNAPSHOT_EXPIRIES)) {
+        clock = reinterpret_cast<const SnapshotClock*>(take(1, sizeof(SnapshotClock)));
+        if (clock) expiries = reinterpret_cast<const SnapshotExpiry*>(take(clock->expiries, sizeof(SnapshotExpiry)));
+        ok = expiries != nullptr;
+    }
+    const SnapshotOwners* owners = nullptr;
+    const SnapshotOwner* owned = nullptr;
+    if (ok && (header.flags & SNAPSHOT_OWNERS)) {
+        owners = reinterpret_cast<const SnapshotOwners*>(take(1, sizeof(SnapshotOwners)));
+        if (owners) owned = reinterpret_cast<const SnapshotOwner*>(take(owners->count, sizeof(SnapshotOwner)));
+        ok = owned != nullptr;
+    }
+    if (!ok || offset != file.size()) {
+        throw std::runtime_error(path + " is not a snapshot!");
+    }
+
+    // grow the pool to its old size in one go - one mapping instead of a chunk at a time
+    order_pool_.reserve(std::max<uint64_t>(header.pool_capacity, header.orders));
+    // the IDs come in price order, so lookup inserts land all over the map - fault every page in
+    // up front rather than one random page fault at a time
+    if (header.next_order_id > 1) order_lookup_.reserve(header.next_order_id - 1);
+
+    // the iceberg records are in the order their orders come up below - `next_ice` is the next one due
+    const SnapshotIceberg* icebergs = reinterpret_cast<const SnapshotIceberg*>(
+        file.data() + book_bytes - header.icebergs * sizeof(SnapshotIceberg));
+    uint32_t next_ice = 0;
+
+    const uint8_t* p = file.data() + sizeof(SnapshotHeader);
+    for (uint64_t l = 0; l < header.levels; ++l) {
+        const SnapshotLevel& sl = *reinterpret_cast<const SnapshotLevel*>(p);
+        const SnapshotOrder* orders = reinterpret_cast<const SnapshotOrder*>(p + sizeof(SnapshotLevel));
+        p += sizeof(SnapshotLevel) + sl.count * sizeof(SnapshotOrder);
+
+        const OrderSide side = l < header.bid_levels ? OrderSide::Buy : OrderSide::Sell;
+        PriceLadder& ladder = side == OrderSide::Buy ? bids_ : asks_;
+        PriceLevel& level = ladder.get_or_add(sl.price);
+
+        // orders are in queue order in the file, so appending them one by one rebuilds the fifo
+        uint64_t qty = 0, hidden = 0;
+        for (uint32_t i = 0; i < sl.count; ++i) {
+            if (i + PREFETCH_AHEAD < sl.count) order_lookup_.prefetch(orders[i + PREFETCH_AHEAD].order_id);
+            Order* o;
+            if (next_ice < header.icebergs && icebergs[next_ice].order_id == orders[i].order_id) {
+                IcebergOrder* ice = icebergs_.get_order();
+                ice->display = static_cast<Quantity>(icebergs[next_ice].display);
+                ice->hidden  = static_cast<Quantity>(icebergs[next_ice].hidden);
+                hidden += ice->hidden;
+                ++next_ice;
+                o = &ice->order;
+                o->type = OrderType::Iceberg;
+            } else {
+                o = order_pool_.get_order();
+                o->type = OrderType::Limit;
+            }
+            o->order_id = orders[i].order_id;
+            o->has_cold = 0; // the slot may have been used before reset()
+            o->side     = side;
+            o->price    = sl.price;
+            o->quantity = orders[i].quantity;
+            level.push_back(o);
+            order_lookup_.insert(o->order_id, o);
+            qty += o->quantity;
+        }
+        ladder.index_add(sl.price, static_cast<int64_t>(qty));
+        if (hidden) ladder.add_hidden(sl.price, static_cast<int64_t>(hidden));
+    }
+
+    if (next_ice != header.icebergs) {
+        throw std::runtime_error(path + " is not a snapshot!"); // an iceberg record for an order that isn't there
+    }
+
+    // stops are in firing order, so adding them in file order puts each trigger level's queue back as it was
+    const SnapshotStop* stops = reinterpret_cast<const SnapshotStop*>(p);
+    for (uint64_t i = 0; i < header.stops; ++i) {
+        Order o(stops[i].side, stops[i].type, stops[i].price, static_cast<Quantity>(stops[i].quantity));
+        o.order_id = stops[i].order_id;
+        stop_book(stops[i].trigger).add(o, stops[i].trigger);
+    }
+
+    if (clock) {
+        clock_ = clock->clock;
+        day_close_ = clock->day_close;
+        for (uint64_t i = 0; i < clock->expiries; ++i) {
+            expiry_wheel().insert(expiries[i].order_id, expiry_tick(expiries[i].expire_time));
+        }
+    }
+    if (owners) {
+        owners_ = std::make_unique<OwnerIndex>(); // even if it's empty, so the next snapshot keeps the block
+        for (uint64_t i = 0; i < owners->count; ++i) tag_owner(owned[i].owner, owned[i].order_id);
+    }
+
+    order_lookup_.trim();
+    next_order_id_ = header.next_order_id;
+    auction_ = (header.flags & SNAPSHOT_IN_AUCTION) != 0;
+    touch_top_all();
+    if (top_) publish_top({});
+    return header.journal_seq;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+// Snapshot.h - on-disk layout of a book snapshot (OrderBook::save_snapshot / load_snapshot)
+// replaying a whole day's journal to restart means re-matching every order the day ever saw.
+// a snapshot is just what's resting right now: every price level, best price first, with its
+// orders in queue (FIFO) order. loading it rebuilds the levels directly - no matching, one
+// get_or_add per level and a pool grab + link per order - then the journal only has to be
+// replayed from journal_seq + 1.
+//
+// layout: SnapshotHeader, then for each level a SnapshotLevel followed by its `count`
+// SnapshotOrders. bid levels come first (highest price first), then ask levels (lowest first).
+// then `stops` SnapshotStops - the stop orders still waiting, in the order they'd fire.
+// then `icebergs` SnapshotIcebergs - the reserve behind every resting iceberg, in the same order
+// the icebergs appear in the levels, so the loader can match them up with one compare per order.
+// then, if flags has SNAPSHOT_EXPIRIES, a SnapshotClock and its `expiries` SnapshotExpiries - the
+// book's clock and day close, and the expiry of every resting GTT / Day order.
+// then, if flags has SNAPSHOT_OWNERS, a SnapshotOwners and its `count` SnapshotOwners - who owns
+// each resting order and waiting stop that was given an owner.
+// everything is 8-byte aligned so the loader reads it in place off a MappedFile.
+// the magic doubles as the format version. OBSNAP01 files had a 64-bit pool_capacity where
+// pool_capacity + flags are now, so they're refused rather than read with garbage flags - take a
+// fresh snapshot (or replay the journal) after upgrading
+
+#include "Order.h"
+#include <cstdint>
+
+// bumped from OBSNAP01 when pool_capacity shrank to 32 bits to make room for flags
+inline constexpr char SNAPSHOT_MAGIC[8] = {'O', 'B', 'S', 'N', 'A', 'P', '0', '2'};
+
+struct SnapshotHeader {
+    char     magic[8];      // SNAPSHOT_MAGIC
+    uint64_t next_order_id; // the ID the next new order gets - IDs carry on exactly where they were
+    uint64_t journal_seq;   // journal records already reflected in this snapshot (0 = no journal)
+    uint64_t orders;        // resting orders in the file
+    uint64_t levels;        // bid + ask levels in the file
+    uint32_t pool_capacity; // order pool size when it was taken - the loader pre-grows to this
+    uint32_t flags;         // SNAPSHOT_IN_AUCTION / SNAPSHOT_EXPIRIES / SNAPSHOT_OWNERS
+    uint32_t bid_levels;    // the first bid_levels levels are bids, the rest asks
+    uint32_t icebergs;      // SnapshotIcebergs after the stops
+    uint64_t stops;         // SnapshotStops after the last level
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout changed");
+
+inline constexpr uint32_t SNAPSHOT_IN_AUCTION = 1; // taken in an auction's call phase - the book can be crossed
+inline constexpr uint32_t SNAPSHOT_EXPIRIES   = 2; // has the SnapshotClock block at the end
+inline constexpr uint32_t SNAPSHOT_OWNERS     = 4; // has the SnapshotOwners block after that
+
+struct SnapshotLevel {
+    int32_t  price;  // ticks
+    uint32_t count;  // SnapshotOrders that follow
+};
+
+struct SnapshotOrder {
+    uint64_t order_id;
+    uint64_t quantity; // what's left resting
+};
+
+struct SnapshotStop {
+    uint64_t  order_id;
+    uint64_t  quantity;
+    int32_t   trigger; // ticks
+    int32_t   price;   // limit price it goes in at (unused for a plain stop)
+    OrderSide side;
+    OrderType type;    // what it goes in as when it fires
+    uint8_t   reserved[6];
+};
+
+// the displayed slice is the level's SnapshotOrder - this is only what Iceberg.h keeps beside it
+struct SnapshotIceberg {
+    uint64_t order_id;
+    uint64_t hidden;
+    uint32_t display;
+    uint32_t reserved;
+};
+
+// the header has no room left, so the clock goes in a block of its own at the end
+struct SnapshotClock {
+    uint64_t clock;     // OrderBook::current_time()
+    uint64_t day_close;
+    uint64_t expiries;  // SnapshotExpiries after this
+    uint64_t reserved;
+};
+
+// only for orders still resting - wheel entries for orders that have gone aren't written
+struct SnapshotExpiry {
+    uint64_t order_id;
+    uint64_t expire_time; // rounded up to the wheel tick it was in, in clock units
+};
+
+struct SnapshotOwners {
+    uint64_t count;    // SnapshotOwner records after this
+    uint64_t reserved;
+};
+
+// only for orders still there - resting or a stop still waiting. each owner's are in list order
+// (per side and lane, resting then stops, oldest first), so a restore links them back up the same
+// way and mass_cancel takes them out in the same order it would have
+struct SnapshotOwner {
+    uint64_t order_id;
+    uint32_t owner;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotLevel) == 8 && sizeof(SnapshotOrder) == 16 && sizeof(SnapshotStop) == 32 &&
+              sizeof(SnapshotIceberg) == 24 && sizeof(SnapshotClock) == 32 && sizeof(SnapshotExpiry) == 16 &&
+              sizeof(SnapshotOwners) == 16 && sizeof(SnapshotOwner) == 16,
+              "snapshot record layout changed");
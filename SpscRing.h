@@ -0,0 +1,78 @@
+#pragma once
+
+// SpscRing.h - fixed-capacity single-producer / single-consumer queue
+// this is how messages get between threads without ever taking a lock - exactly one thread
+// pushes, exactly one thread pops, and the only shared state is two indices.
+// MatchingEngine.h uses one per shard to hand commands from the gateway thread to the matcher.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 64 bytes on everything we care about - hardcoded because
+// std::hardware_destructive_interference_size warns on gcc and isn't there on older libstdc++
+inline constexpr size_t CACHE_LINE = 64;
+
+// capacity is rounded up to a power of two so the slot is just index & mask, no modulo
+// head_ and tail_ live on their own cache lines so the producer and consumer aren't fighting
+// over the same line, and each side keeps a cached copy of the other side's index so it only
+// touches the shared line when it looks full / empty
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        slots_.resize(cap);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // producer side - returns false if the ring is full, never blocks
+    bool try_push(const T& item) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) return false;
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side - returns false if the ring is empty, never blocks
+    bool try_pop(T& out) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate - only exact when called from one of the two sides with the other one idle
+    size_t size() const {
+        return static_cast<size_t>(tail_.load(std::memory_order_acquire) -
+                                   head_.load(std::memory_order_acquire));
+    }
+    bool   empty()    const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    // producer-owned line: where the next push goes, plus the producer's view of head_
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail_{0};
+    uint64_t head_cache_ = 0;
+
+    // consumer-owned line: where the next pop comes from, plus the consumer's view of tail_
+    alignas(CACHE_LINE) std::atomic<uint64_t> head_{0};
+    uint64_t tail_cache_ = 0;
+
+    // read-only after construction, so sharing this line between both sides is fine
+    alignas(CACHE_LINE) std::vector<T> slots_;
+    size_t mask_;
+};
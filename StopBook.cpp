@@ -0,0 +1,83 @@
+#include "StopBook.h"
+#include <algorithm>
+#include <type_traits>
+
+// StopBook.cpp - adding, cancelling and firing stops
+// see StopBook.h for the trigger rules and the firing order
+
+// the levels link &StopOrder::order, and cancel / for_each get back to the StopOrder from that -
+// only allowed because order is the first member of a standard-layout struct
+static_assert(std::is_standard_layout_v<StopOrder>, "StopOrder must stay standard-layout");
+
+StopBook::StopBook(int32_t centre, uint32_t ticks) : buys_(centre, ticks), sells_(centre, ticks) {
+}
+
+Order* StopBook::add(const Order& order, int32_t trigger) {
+    StopOrder* stop;
+    if (free_) {
+        stop = reinterpret_cast<StopOrder*>(free_);
+        free_ = free_->next;
+    } else {
+        stop = &slots_.emplace_back();
+    }
+    stop->order = order;
+    stop->order.has_cold = 0; // the cold entry is whatever the slot's last stop left
+    stop->trigger = trigger;
+
+    if (order.side == OrderSide::Buy) {
+        buys_.get_or_add(trigger).push_back(&stop->order);
+        buy_trigger_ = std::min(buy_trigger_, trigger);
+    } else {
+        sells_.get_or_add(trigger).push_back(&stop->order);
+        sell_trigger_ = std::max(sell_trigger_, trigger);
+    }
+    ids_.insert(order.order_id, &stop->order);
+    ++size_;
+    return &stop->order;
+}
+
+bool StopBook::cancel(uint64_t order_id) {
+    Order* order = ids_.find(order_id);
+    if (order == nullptr) return false;
+    cancel(order);
+    return true;
+}
+
+void StopBook::cancel(Order* stop) {
+    remove(reinterpret_cast<StopOrder*>(stop));
+    refresh_triggers();
+}
+
+bool StopBook::pop_triggered(int32_t low, int32_t high, Order& out, OrderCold& out_cold) {
+    StopOrder* stop;
+    if (high >= buy_trigger_) {
+        stop = reinterpret_cast<StopOrder*>(buys_.at(buy_trigger_).front());
+    } else if (low <= sell_trigger_) {
+        stop = reinterpret_cast<StopOrder*>(sells_.at(sell_trigger_).front());
+    } else {
+        return false;
+    }
+    out = stop->order;
+    out.prev = out.next = nullptr;
+    if (out.has_cold) out_cold = stop->cold;
+    remove(stop);
+    refresh_triggers();
+    return true;
+}
+
+void StopBook::remove(StopOrder* stop) {
+    PriceLadder& ladder = stop->order.side == OrderSide::Buy ? buys_ : sells_;
+    PriceLevel& level = ladder.at(stop->trigger);
+    level.erase(&stop->order);
+    if (level.empty()) ladder.erase(stop->trigger);
+    ids_.erase(stop->order.order_id);
+
+    stop->order.next = free_;
+    free_ = &stop->order;
+    --size_;
+}
+
+void StopBook::refresh_triggers() {
+    buy_trigger_  = buys_.empty() ? INT32_MAX : buys_.lowest();
+    sell_trigger_ = sells_.empty() ? INT32_MIN : sells_.highest();
+}
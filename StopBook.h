@@ -0,0 +1,87 @@
+#pragma once
+
+// StopBook.h - stop and stop-limit orders waiting for their trigger price to trade
+// a stop isn't in the book and can't match - it sits here until a trade prints at or through
+// its trigger, then goes in as whatever order it carries (market for a plain stop, limit for a
+// stop-limit). checking every pending stop after every trade would make each trade O(stops),
+// so they're kept in two ladders keyed by trigger price (the same PriceLadder the book uses):
+//   buy stops  - fire on a trade at or above the trigger, lowest trigger first
+//   sell stops - fire on a trade at or below the trigger, highest trigger first
+// the nearest trigger on each side is cached, so "did that set anything off" is two compares
+// no matter how many stops are waiting. OrderBook owns one of these (made the first time a stop
+// comes in) and does the firing - see OrderBook::place_stop
+
+#include "Order.h"
+#include "OrderIdMap.h"
+#include "PriceLadder.h"
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+struct StopOrder {
+    Order     order;   // what goes in when it fires - side, type, limit price, quantity, its ID.
+                       // order.prev / order.next link it into its trigger level
+    int32_t   trigger; // ticks
+    OrderCold cold;    // its owner links (see OwnerIndex.h) - only read if order.has_cold
+};
+
+// only valid for an Order* that StopBook handed out
+inline OrderCold& stop_cold(Order* o) { return reinterpret_cast<StopOrder*>(o)->cold; }
+
+class StopBook {
+public:
+    // band for the two trigger ladders - they re-centre like the book's if a trigger falls outside
+    StopBook(int32_t centre, uint32_t ticks);
+
+    StopBook(const StopBook&) = delete;
+    StopBook& operator=(const StopBook&) = delete;
+
+    // order.order_id must already be set - a stop gets its ID when it's placed and keeps it.
+    // returns where it's waiting - stays put until it fires or is cancelled
+    Order* add(const Order& order, int32_t trigger);
+    bool contains(uint64_t order_id) const { return ids_.find(order_id) != nullptr; }
+    // whether add can take this trigger without its ladder throwing (see PriceLadder::fits)
+    bool fits(OrderSide side, int32_t trigger) const { return (side == OrderSide::Buy ? buys_ : sells_).fits(trigger); }
+    Order* find(uint64_t order_id) const { return ids_.find(order_id); } // nullptr if it isn't waiting
+    bool cancel(uint64_t order_id);
+    void cancel(Order* stop); // one find() handed back
+
+    // has a trade somewhere in [low, high] set off at least one stop
+    bool triggered(int32_t low, int32_t high) const { return high >= buy_trigger_ || low <= sell_trigger_; }
+
+    // takes out the next stop a trade in [low, high] has set off and copies its order to `out`,
+    // false if there isn't one. buy stops go before sell stops, then trigger priority, then the
+    // order they were placed in - so the same input always fires them in the same order.
+    // if out.has_cold, its cold entry is copied to out_cold on the way out
+    bool pop_triggered(int32_t low, int32_t high, Order& out, OrderCold& out_cold);
+
+    size_t size() const { return size_; }
+
+    // every waiting stop in firing order (buys lowest trigger first, then sells highest first) -
+    // no allocation, so the snapshot writer can call it in a forked child
+    template <class F>
+    void for_each(F&& f) const {
+        for (int32_t p = buys_.lowest(); p != PriceLadder::npos; p = buys_.next_higher(p))
+            for (const Order* o : buys_.at(p)) f(*reinterpret_cast<const StopOrder*>(o));
+        for (int32_t p = sells_.highest(); p != PriceLadder::npos; p = sells_.next_lower(p))
+            for (const Order* o : sells_.at(p)) f(*reinterpret_cast<const StopOrder*>(o));
+    }
+
+private:
+    PriceLadder buys_;
+    PriceLadder sells_;
+    OrderIdMap  ids_; // order ID -> &StopOrder::order, for cancel
+
+    // StopOrders never move once made - a deque only ever adds blocks. freed ones are threaded
+    // through order.next and reused first
+    std::deque<StopOrder> slots_;
+    Order* free_ = nullptr;
+    size_t size_ = 0;
+
+    int32_t buy_trigger_  = INT32_MAX; // lowest buy trigger, INT32_MAX if there are no buy stops
+    int32_t sell_trigger_ = INT32_MIN; // highest sell trigger, INT32_MIN if there are no sell stops
+
+    void remove(StopOrder* stop); // unlink from its level and ID, give the slot back
+    void refresh_triggers();
+};
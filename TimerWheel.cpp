@@ -0,0 +1,64 @@
+#include "TimerWheel.h"
+
+// TimerWheel.cpp - the cold parts of the wheel: finding the next event and cascading
+// see TimerWheel.h
+
+uint64_t TimerWheel::next_event() const {
+    // a level's slots all lie inside the current slot one level up, so anything on a lower level
+    // comes before anything on a higher one - the first non-empty level has the answer
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        if (occupied_[level] == 0) continue;
+        const unsigned shift = level * SLOT_BITS;
+        const unsigned current = static_cast<unsigned>((now_ >> shift) & (SLOTS - 1));
+        // place() only ever puts entries ahead of the current slot
+        const uint64_t ahead = current == SLOTS - 1 ? 0 : occupied_[level] & (~0ULL << (current + 1));
+        if (ahead == 0) continue;
+        const uint64_t window = now_ >> (shift + SLOT_BITS) << (shift + SLOT_BITS);
+        // level 0: the tick the entries fire on. higher: where the slot's range starts, which is
+        // when its entries cascade down
+        return window | static_cast<uint64_t>(__builtin_ctzll(ahead)) << shift;
+    }
+    if (!overflow_.empty()) return overflow_min_ >> WHEEL_BITS << WHEEL_BITS;
+    return UINT64_MAX;
+}
+
+void TimerWheel::cascade() {
+    if (!overflow_.empty() && (now_ & ((1ULL << WHEEL_BITS) - 1)) == 0) {
+        // once every 2^36 ticks - whatever's come within reach goes into the levels
+        std::vector<Entry> far;
+        far.swap(overflow_);
+        overflow_min_ = UINT64_MAX;
+        for (const Entry& e : far) place(e);
+    }
+    // top down, so an entry that drops several levels is cascaded again further down this same pass
+    for (unsigned level = LEVELS - 1; level > 0; --level) {
+        const unsigned shift = level * SLOT_BITS;
+        if ((now_ & ((1ULL << shift) - 1)) != 0) continue; // not the start of a slot at this level
+        const unsigned slot = static_cast<unsigned>((now_ >> shift) & (SLOTS - 1));
+        if (!(occupied_[level] >> slot & 1)) continue;
+        occupied_[level] &= ~(1ULL << slot);
+        // every entry here now matches now_ from this level up, so each lands on a lower level
+        std::vector<Entry>& from = slots_[level][slot];
+        if (!move_whole(from)) {
+            for (const Entry& e : from) place(e);
+        }
+        from.clear();
+    }
+}
+
+bool TimerWheel::move_whole(std::vector<Entry>& from) {
+    // every Day order has the same tick (the close), so a day's worth of them share one slot all
+    // the way down - moving the vector is O(1) a level rather than a copy of the lot. the scan
+    // stops at the first different tick, which for spread-out GTT times is straight away
+    const uint64_t tick = from.front().tick;
+    for (const Entry& e : from) {
+        if (e.tick != tick) return false;
+    }
+    const unsigned level = level_of(tick);
+    const unsigned slot  = static_cast<unsigned>((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+    std::vector<Entry>& to = slots_[level][slot];
+    if (!to.empty()) return false;
+    to.swap(from); // from gets to's old (empty) buffer, so the capacity stays in the wheel
+    occupied_[level] |= 1ULL << slot;
+    return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+// TimerWheel.h - hierarchical timer wheel, what expires GTT / Day orders (OrderBook::advance_time)
+// a sorted structure (a heap, a map keyed by expiry) costs O(log N) per order going in and
+// coming out. a wheel is O(1) for both: time is cut into ticks, and an entry goes into the slot
+// for its tick. one flat ring of slots would need a slot per tick out to the furthest expiry, so
+// there are levels instead - 64 slots each, level 0 a tick per slot, level 1 64 ticks per slot,
+// level 2 4096 ... six levels cover 2^36 ticks (over two years at 1 ms). an entry goes in the
+// lowest level whose slot still tells it apart from now. when time reaches the start of a
+// higher-level slot its entries are re-placed ("cascaded") one level down, or more, and the ones
+// that make it to level 0 fire when their tick comes up. an entry moves at most once per level,
+// so it's still O(1) per entry however far out it was.
+//
+// each level keeps a 64-bit occupancy word, so finding the next tick anything happens is a ctz
+// on the lowest non-empty level - advancing over an idle night is a handful of jumps, not a loop
+// over every tick in it. anything further out than the wheel reaches waits in an overflow list
+// that's looked at once every 2^36 ticks.
+//
+// entries are just (id, tick) - nothing can be taken out early. the book doesn't need to: an
+// entry whose order was filled or cancelled first is skipped when it fires, so fills and cancels
+// never touch the wheel. slots are vectors that keep their capacity once they've grown. a slot
+// that's all one tick (a day's Day orders, all expiring at the close) cascades by swapping its
+// vector into the slot below rather than copying it, so the close costs one pass over the entries
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TimerWheel {
+public:
+    static constexpr unsigned SLOT_BITS  = 6;
+    static constexpr unsigned SLOTS      = 1u << SLOT_BITS; // one occupancy word per level
+    static constexpr unsigned LEVELS     = 6;
+    static constexpr unsigned WHEEL_BITS = SLOT_BITS * LEVELS; // ticks past now() the levels reach
+
+    explicit TimerWheel(uint64_t now = 0) : now_(now) {}
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    uint64_t now()  const { return now_; }  // every tick up to and including this one has fired
+    size_t   size() const { return size_; } // entries waiting
+
+    // `id` fires on the advance() that reaches `tick`. a tick that's already passed fires on the next one
+    void insert(uint64_t id, uint64_t tick) {
+        place({id, std::max(tick, now_ + 1)});
+        ++size_;
+    }
+
+    // moves time forward to `tick`, calling expire(id) for everything due up to and including
+    // it - earlier ticks first, in no particular order within a tick. expire mustn't insert
+    template <typename F>
+    void advance(uint64_t tick, F&& expire) {
+        while (now_ < tick) {
+            const uint64_t next = next_event();
+            if (next > tick) {
+                now_ = tick;
+                return;
+            }
+            now_ = next;
+            cascade();
+            const unsigned slot = static_cast<unsigned>(now_ & (SLOTS - 1));
+            if (occupied_[0] >> slot & 1) {
+                occupied_[0] &= ~(1ULL << slot);
+                std::vector<Entry>& due = slots_[0][slot];
+                for (const Entry& e : due) expire(e.id);
+                size_ -= due.size();
+                due.clear();
+            }
+        }
+    }
+
+    // every waiting entry as f(id, tick) - for snapshots. doesn't allocate
+    template <typename F>
+    void for_each(F&& f) const {
+        for (unsigned level = 0; level < LEVELS; ++level) {
+            for (uint64_t bits = occupied_[level]; bits != 0; bits &= bits - 1) {
+                for (const Entry& e : slots_[level][__builtin_ctzll(bits)]) f(e.id, e.tick);
+            }
+        }
+        for (const Entry& e : overflow_) f(e.id, e.tick);
+    }
+
+private:
+    struct Entry {
+        uint64_t id;
+        uint64_t tick;
+    };
+
+    uint64_t now_;
+    size_t   size_ = 0;
+    uint64_t occupied_[LEVELS] = {};           // bit s: slots_[level][s] has entries
+    std::vector<Entry> slots_[LEVELS][SLOTS];
+    std::vector<Entry> overflow_;              // more than 2^36 ticks out when they went in
+    uint64_t overflow_min_ = UINT64_MAX;
+
+    // the 6-bit group holding the highest bit where tick and now_ differ, so the slot is always
+    // ahead of now_'s own slot at that level and inside the same window above it
+    unsigned level_of(uint64_t tick) const {
+        const uint64_t diff = tick ^ now_;
+        return diff == 0 ? 0 : (63 - __builtin_clzll(diff)) / SLOT_BITS;
+    }
+
+    void place(const Entry& e) {
+        const unsigned level = level_of(e.tick);
+        if (level >= LEVELS) {
+            overflow_.push_back(e);
+            overflow_min_ = std::min(overflow_min_, e.tick);
+            return;
+        }
+        const unsigned slot = static_cast<unsigned>((e.tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+        slots_[level][slot].push_back(e);
+        occupied_[level] |= 1ULL << slot;
+    }
+
+    // the next tick after now_ where something fires or cascades, UINT64_MAX if nothing's waiting
+    uint64_t next_event() const;
+
+    // re-places every higher-level slot (and the overflow) whose range starts at now_
+    void cascade();
+
+    // cascades a slot that's all one tick by swapping its vector into the empty slot below,
+    // false (nothing moved) if it isn't or that slot has entries
+    bool move_whole(std::vector<Entry>& from);
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+// TopOfBook.h - best bid / offer and the top few levels of depth, readable from any thread
+// get_best_bid / get_depth read the ladders directly, so they're matching-thread only - a strategy
+// or risk thread calling them while the book is matching would be reading levels half way through
+// being changed. instead the book publishes a small fixed-size block (TopOfBookView) here after
+// every call that changed it, and other threads read that.
+//
+// the block is guarded by a sequence lock. the matcher bumps the sequence to odd, writes the
+// block, and bumps it back to even. a reader reads the sequence, copies the block, and reads the
+// sequence again - if it was odd or it moved, a publish got in the way and it just copies again.
+// readers never write anything shared, so any number of them cost the matcher nothing beyond the
+// cache misses on lines they've pulled away from it, and the matcher never waits for a reader.
+//
+// the book only republishes what a call could have changed. it keeps, per side, the best price
+// the call touched inside the published rows - a trade, or an add / cancel / modify there - and
+// rewalks that side from that row down; rows in front of it can't have moved. staging compares
+// each word with what's already out, and publish() writes only the words that differ, or skips
+// the sequence lock entirely if none do. an order resting 50 ticks behind the touch costs one
+// compare. OrderBook::set_top_of_book() turns it on - with nothing attached the hooks cost one
+// branch, same as the market data feed
+
+#include "SpscRing.h"
+#include "WaitStrategy.h"
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// one row of aggregated depth - what get_depth() fills in
+struct DepthLevel {
+    int32_t  price;    // ticks
+    uint32_t count;    // orders resting at this price
+    uint64_t quantity; // total quantity resting at this price
+};
+
+// rows per side the block has room for
+inline constexpr size_t TOP_LEVELS = 8;
+
+struct TopOfBookView {
+    uint64_t version = 0;       // publishes so far - every one of them changed something
+    uint64_t last_quantity = 0; // last trade (0 before the first one)
+    int32_t  last_price = 0;
+    uint32_t bid_levels = 0;    // rows filled in below, best first. rows past these are left over
+    uint32_t ask_levels = 0;    // from earlier publishes - don't read them
+    uint32_t in_auction = 0;    // 1 in an auction's call phase, where the book can be crossed
+    DepthLevel bids[TOP_LEVELS] = {};
+    DepthLevel asks[TOP_LEVELS] = {};
+
+    int32_t best_bid() const { return bid_levels ? bids[0].price : 0; }
+    int32_t best_ask() const { return ask_levels ? asks[0].price : 0; }
+};
+
+static_assert(std::is_trivially_copyable_v<TopOfBookView> && sizeof(TopOfBookView) % 8 == 0,
+              "TopOfBookView is copied as 64-bit words");
+static_assert(std::endian::native == std::endian::little, "TopOfBook packs 32-bit field pairs into words");
+
+class TopOfBook {
+public:
+    // levels: rows per side to publish, 1 - TOP_LEVELS. 1 is just the BBO, and the cheapest - the
+    // fewer rows, the fewer calls land inside them and the less there is to copy when one does
+    explicit TopOfBook(size_t levels = TOP_LEVELS)
+        : levels_(levels == 0 ? 1 : (levels > TOP_LEVELS ? TOP_LEVELS : levels)) {}
+
+    TopOfBook(const TopOfBook&) = delete;
+    TopOfBook& operator=(const TopOfBook&) = delete;
+
+    size_t levels() const { return levels_; }
+
+    // --- any thread ---
+
+    // a consistent copy of the latest publish. spins (briefly - a publish is a few dozen stores)
+    // if the matcher is half way through one
+    TopOfBookView read() const {
+        TopOfBookView view;
+        while (!try_read(view)) cpu_relax();
+        return view;
+    }
+
+    // one attempt - false if a publish got in the way, and `out` is then garbage
+    bool try_read(TopOfBookView& out) const {
+        const uint64_t before = seq_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        uint64_t buf[WORDS];
+        for (size_t i = 0; i < WORDS; ++i) buf[i] = words_[i].load(std::memory_order_relaxed);
+        // keeps the copy above from being reordered after the second sequence read
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != before) return false;
+        std::memcpy(&out, buf, sizeof(out));
+        return true;
+    }
+
+    // how many publishes so far - cheap, for a reader polling for a change before paying for a read()
+    uint64_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+    // --- matching thread (OrderBook) ---
+
+    // the next publish, filled in a field at a time and then sent with publish(). rows are
+    // 0 - levels()-1. anything not staged again keeps its value from the last publish, and so
+    // does anything staged again with the value it already had
+    void stage_bid(size_t row, int32_t price, uint32_t count, uint64_t quantity) { stage_row(BIDS_WORD + row * 2, price, count, quantity); }
+    void stage_ask(size_t row, int32_t price, uint32_t count, uint64_t quantity) { stage_row(ASKS_WORD + row * 2, price, count, quantity); }
+    void stage_trade(int32_t price, uint64_t quantity) {
+        stage_word(1, quantity);
+        stage_word(2, pack(price, static_cast<uint32_t>(staged_[2] >> 32)));
+    }
+    void stage_counts(uint32_t bid_levels, uint32_t ask_levels, bool in_auction) {
+        stage_word(2, pack(static_cast<int32_t>(staged_[2]), bid_levels));
+        stage_word(3, pack(static_cast<int32_t>(ask_levels), in_auction));
+    }
+
+    // sends the words staged since the last publish that changed, plus the version. nothing
+    // changed means no publish at all - the sequence doesn't move and readers aren't disturbed
+    void publish() {
+        if (dirty_lo_ >= dirty_hi_) return;
+        const uint64_t seq = seq_.load(std::memory_order_relaxed);
+        staged_[0] = seq / 2 + 1; // version
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        // the odd sequence has to be visible before any of the new words are
+        std::atomic_thread_fence(std::memory_order_release);
+        store_words(0, 1);
+        store_words(dirty_lo_, dirty_hi_ - dirty_lo_);
+        seq_.store(seq + 2, std::memory_order_release);
+        dirty_lo_ = WORDS;
+        dirty_hi_ = 0;
+    }
+
+private:
+    static constexpr size_t WORDS        = sizeof(TopOfBookView) / 8;
+    static constexpr size_t ROW_WORDS    = sizeof(DepthLevel) / 8;
+    static constexpr size_t HEADER_WORDS = offsetof(TopOfBookView, bids) / 8;
+    static constexpr size_t BIDS_WORD    = offsetof(TopOfBookView, bids) / 8;
+    static constexpr size_t ASKS_WORD    = offsetof(TopOfBookView, asks) / 8;
+    static_assert(HEADER_WORDS == 4 && ROW_WORDS == 2, "stage_* assume this layout");
+
+    // two 32-bit fields as the word they make in TopOfBookView - low one first
+    static uint64_t pack(int32_t low, uint32_t high) {
+        return static_cast<uint32_t>(low) | static_cast<uint64_t>(high) << 32;
+    }
+    // widens the range publish() stores if the word actually changes
+    void stage_word(size_t word, uint64_t value) {
+        if (staged_[word] == value) return;
+        staged_[word] = value;
+        if (word < dirty_lo_) dirty_lo_ = word;
+        if (word >= dirty_hi_) dirty_hi_ = word + 1;
+    }
+    void stage_row(size_t word, int32_t price, uint32_t count, uint64_t quantity) {
+        stage_word(word, pack(price, count));
+        stage_word(word + 1, quantity);
+    }
+    void store_words(size_t first, size_t n) {
+        for (size_t i = first; i < first + n; ++i) words_[i].store(staged_[i], std::memory_order_relaxed);
+    }
+
+    const size_t levels_;
+
+    // the writer's copy, laid out word for word like TopOfBookView. staged a whole word at a time
+    // so publish() reads back exactly what was stored - copying a struct filled in with 4-byte
+    // field stores out as 8-byte words stalls on every word that straddles two of them
+    uint64_t staged_[WORDS] = {};
+    // words [dirty_lo_, dirty_hi_) of staged_ may differ from what readers have - one range across
+    // header and both sides, since re-storing an unchanged word in the middle costs nothing
+    size_t dirty_lo_ = WORDS;
+    size_t dirty_hi_ = 0;
+
+    // the sequence sits right in front of the block it guards, so a reader's first miss brings in
+    // the sequence and the header together. the block is written as relaxed atomic words rather
+    // than a plain memcpy so a reader copying it mid-publish is a retry, not a data race
+    alignas(CACHE_LINE) std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> words_[WORDS]{};
+};
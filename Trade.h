@@ -2,17 +2,22 @@
 
 // Trade.h - defines what a trade looks like
 // a trade gets created inside match_and_fill (OrderBook.cpp) every time two orders cross.
-// trades get stored in trades_buf_ and executed_trades_ on the orderbook,
+// trades get stored in trades_buf_ and the trade log (TradeLog.h) on the orderbook,
 // and returned to the caller via a span in ProcessOrderResult.
 
+#include "Order.h"
 #include <cstdint>
 
 // a trade - just holds the info about what happened when two orders matched
 // no timestamp anymore - it was never actually used and calling chrono on every trade was slow
 
+// every fill writes one of these twice (the result buffer and the trade log ring), so it's packed
+// the same way as Order - 24 bytes with 32-bit quantities, down from 32 with a padded 64-bit one
 struct Trade {
     uint64_t buyer_order_id;
     uint64_t seller_order_id;
-    int32_t price;     // price in ticks at which the trade happened (1 tick = $0.01)
-    uint64_t quantity;
+    int32_t  price;    // price in ticks at which the trade happened (1 tick = $0.01)
+    Quantity quantity;
 };
+
+static_assert(sizeof(Trade) == (sizeof(Quantity) == 4 ? 24 : 32), "Trade layout changed");
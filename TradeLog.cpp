@@ -0,0 +1,133 @@
+#include "TradeLog.h"
+#include "WaitStrategy.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// TradeLog.cpp - the spill thread and the trade file, see TradeLog.h
+
+static constexpr size_t FILE_GROW_BYTES = 64 * 1024 * 1024;
+static constexpr size_t SPILL_BATCH     = 4096; // trades per header update
+
+TradeLog::TradeLog(size_t ring_capacity, const std::string& path, size_t max_file_bytes) {
+    size_t cap = 2;
+    while (cap < ring_capacity) cap <<= 1;
+    mask_ = cap - 1;
+    slots_.resize(cap);
+
+    if (path.empty()) return;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Could not open trade log " + path + "!");
+    }
+    // map the whole window once - only the part below file_bytes_ is ever touched, so there's
+    // no remapping (and no moving pointers for history()) as the file grows
+    map_bytes_ = max_file_bytes;
+    void* p = ::mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("Could not mmap trade log " + path + "!");
+    }
+    map_ = static_cast<uint8_t*>(p);
+    if (!ensure_file_size(sizeof(TradeFileHeader))) {
+        ::munmap(map_, map_bytes_);
+        ::close(fd_);
+        throw std::runtime_error("Could not size trade log " + path + "!");
+    }
+
+    TradeFileHeader* header = reinterpret_cast<TradeFileHeader*>(map_);
+    std::memcpy(header->magic, "OBTRADE1", 8);
+    header->count = 0;
+    header->dropped = 0;
+    header->record_size = sizeof(Trade);
+    file_ = reinterpret_cast<Trade*>(map_ + sizeof(TradeFileHeader));
+
+    spill_thread_ = std::thread([this] { spill_loop(); });
+}
+
+TradeLog::~TradeLog() {
+    if (!spilling()) return;
+    stop_.store(true, std::memory_order_release);
+    spill_thread_.join();
+
+    // trim the growth slack off so the file is exactly header + records
+    size_t used = sizeof(TradeFileHeader) + head_.load(std::memory_order_relaxed) * sizeof(Trade);
+    ::munmap(map_, map_bytes_);
+    if (::ftruncate(fd_, static_cast<off_t>(used)) != 0) {
+        // nothing sensible to do from a destructor - the header count is still right
+    }
+    ::close(fd_);
+}
+
+TradeHistory TradeLog::history() const {
+    TradeHistory h;
+    const uint64_t tail = tail_.load(std::memory_order_relaxed); // our own index
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    h.file_       = file_;
+    h.file_count_ = spilling() ? head : 0;
+    h.ring_       = slots_.data();
+    h.ring_first_ = head;
+    h.ring_count_ = tail - head;
+    h.mask_       = mask_;
+    h.dropped_    = dropped();
+    return h;
+}
+
+void TradeLog::flush() const {
+    if (!spilling()) return;
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    IdleWaiter waiter(WaitStrategy::Backoff);
+    while (head_.load(std::memory_order_acquire) < tail) waiter.idle();
+}
+
+void TradeLog::spill_loop() {
+    IdleWaiter waiter(WaitStrategy::Backoff);
+    while (true) {
+        if (spill_batch() > 0) {
+            waiter.reset();
+            continue;
+        }
+        // only stop once the ring is empty, so everything recorded before the destructor ran
+        // ends up in the file (or the file is full and it never will)
+        if (stop_.load(std::memory_order_acquire) && spill_batch() == 0) break;
+        waiter.idle();
+    }
+}
+
+size_t TradeLog::spill_batch() {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    size_t n = static_cast<size_t>(std::min<uint64_t>(tail - head, SPILL_BATCH));
+    if (n == 0) return 0;
+
+    if (!ensure_file_size(sizeof(TradeFileHeader) + (head + n) * sizeof(Trade))) {
+        return 0; // out of window / disk - leave them in the ring, the producer will start dropping
+    }
+
+    // the ring slice can wrap, so it's up to two copies
+    size_t first = static_cast<size_t>(head & mask_);
+    size_t run = std::min(n, slots_.size() - first);
+    std::memcpy(file_ + head, slots_.data() + first, run * sizeof(Trade));
+    std::memcpy(file_ + head + run, slots_.data(), (n - run) * sizeof(Trade));
+
+    TradeFileHeader* header = reinterpret_cast<TradeFileHeader*>(map_);
+    header->count = head + n;
+    header->dropped = dropped();
+
+    // publishing head_ both frees the slots and says "file has head + n records now"
+    head_.store(head + n, std::memory_order_release);
+    return n;
+}
+
+bool TradeLog::ensure_file_size(size_t bytes) {
+    if (bytes <= file_bytes_) return true;
+    if (bytes > map_bytes_) return false;
+    size_t grow = std::min(map_bytes_, std::max(bytes, file_bytes_ + FILE_GROW_BYTES));
+    if (::ftruncate(fd_, static_cast<off_t>(grow)) != 0) return false;
+    file_bytes_ = grow;
+    return true;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+// TradeLog.h - bounded in-memory trade history, optionally spilled to an append-only trade file
+// the book used to push_back every trade into one ever-growing vector - past the reserve it
+// reallocated mid-session (a multi-ms stall with 2.5M trades to copy) and it held every trade in
+// RAM forever. now the matching thread writes each trade into a fixed ring and that's it: a
+// background spill thread drains the ring into a memory-mapped trade file behind it.
+//
+// the matching thread never blocks, allocates or makes a syscall here. if the spill thread falls
+// so far behind that the ring is full, the trade is dropped from the history and counted -
+// the trade still happened and still went back in ProcessOrderResult, it just isn't recorded.
+// with no file the ring is a rolling window of the most recent trades and nothing is dropped.
+//
+// trade file layout: a 64-byte TradeFileHeader, then Trade records back to back in the order
+// they happened. the file is grown in 64 MB steps while it's being written and trimmed to the
+// exact size when the log closes.
+
+#include "Trade.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TradeFileHeader {
+    char     magic[8];    // "OBTRADE1"
+    uint64_t count;       // complete records after the header - updated after every batch
+    uint64_t dropped;     // trades that never made it into the ring
+    uint64_t record_size; // sizeof(Trade), so a reader can tell if the layout changed
+    uint8_t  reserved[32];
+};
+
+static_assert(sizeof(TradeFileHeader) == 64, "trade file header layout changed");
+
+// what get_trade_history() hands back - the spilled trades in the file followed by the ones still
+// in the ring, indexable as one sequence, oldest first. nothing is copied. like the trades span in
+// ProcessOrderResult, only use it on the book's thread and not after the next process_order call
+class TradeHistory {
+public:
+    size_t size()  const { return static_cast<size_t>(file_count_ + ring_count_); }
+    bool   empty() const { return size() == 0; }
+
+    const Trade& operator[](size_t i) const {
+        if (i < file_count_) return file_[i];
+        return ring_[(ring_first_ + (i - file_count_)) & mask_];
+    }
+
+    uint64_t dropped() const { return dropped_; } // trades missing from the history (ring was full)
+
+    class iterator {
+    public:
+        iterator(const TradeHistory* h, size_t i) : h_(h), i_(i) {}
+        const Trade& operator*() const { return (*h_)[i_]; }
+        iterator& operator++() { ++i_; return *this; }
+        bool operator!=(const iterator& o) const { return i_ != o.i_; }
+    private:
+        const TradeHistory* h_;
+        size_t i_;
+    };
+    iterator begin() const { return {this, 0}; }
+    iterator end()   const { return {this, size()}; }
+
+private:
+    friend class TradeLog;
+    const Trade* file_ = nullptr;
+    uint64_t     file_count_ = 0;
+    const Trade* ring_ = nullptr;
+    uint64_t     ring_first_ = 0; // ring index of the oldest trade not in the file
+    uint64_t     ring_count_ = 0;
+    uint64_t     mask_ = 0;
+    uint64_t     dropped_ = 0;
+};
+
+class TradeLog {
+public:
+    // ring_capacity: trades held in memory, rounded up to a power of two
+    // path: trade file to spill to (created / truncated) - empty keeps just the ring, no thread.
+    // max_file_bytes: address space reserved for the file mapping - the file can't outgrow it,
+    // once it's full the spill thread stops and the ring fills up and starts dropping
+    explicit TradeLog(size_t ring_capacity, const std::string& path = "",
+                      size_t max_file_bytes = size_t(1) << 36);
+    ~TradeLog(); // drains the ring into the file and trims it before returning
+
+    TradeLog(const TradeLog&) = delete;
+    TradeLog& operator=(const TradeLog&) = delete;
+
+    // matching thread only - a store into the ring and an index bump
+    void record(const Trade& trade) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            if (!spilling()) {
+                // no file - the oldest trade just falls off the window
+                head_cache_ = tail - mask_;
+                head_.store(head_cache_, std::memory_order_relaxed);
+            } else {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail - head_cache_ > mask_) {
+                    dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+        slots_[tail & mask_] = trade;
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    // same thread as record()
+    TradeHistory history() const;
+
+    // forget the window, for a book that's being reused - no file only (the book checks)
+    void clear() {
+        head_cache_ = tail_.load(std::memory_order_relaxed);
+        head_.store(head_cache_, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+    // blocks until everything recorded so far is in the file (no-op without one)
+    // for shutdown / tests - never call it from the matching path
+    void flush() const;
+
+    bool     spilling() const { return file_ != nullptr; }
+    uint64_t dropped()  const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t spilled()  const { return spilling() ? head_.load(std::memory_order_acquire) : 0; }
+
+private:
+    // producer-owned line: next ring slot to write, plus the producer's view of head_
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail_{0};
+    uint64_t head_cache_ = 0;
+    std::atomic<uint64_t> dropped_{0};
+
+    // consumer-owned line: oldest trade not yet in the file. with a file, head_ is also exactly
+    // how many records the file holds - ring index i is file record i - which is what lets
+    // history() split the two with one load
+    alignas(CACHE_LINE) std::atomic<uint64_t> head_{0};
+    std::atomic<bool> stop_{false};
+
+    alignas(CACHE_LINE) std::vector<Trade> slots_;
+    uint64_t mask_;
+
+    // trade file - only the spill thread writes it, history() reads the part below head_
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;  // whole max_file_bytes window, mapped once up front
+    size_t map_bytes_ = 0;
+    size_t file_bytes_ = 0;   // current file length - ftruncate'd ahead of the writes
+    Trade* file_ = nullptr;   // first record, just past the header
+    std::thread spill_thread_;
+
+    void spill_loop();
+    size_t spill_batch(); // returns how many trades it moved, 0 if there was nothing to do
+    bool   ensure_file_size(size_t bytes);
+};
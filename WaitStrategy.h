@@ -0,0 +1,77 @@
+#pragma once
+
+// WaitStrategy.h - what a thread does when it polls a ring and there's nothing there
+// the matcher threads (MatchingEngine shards, OrderBookRunner) never block on a mutex or a
+// condition variable - they poll. the question is just how hard to spin while idle:
+//   BusySpin - never give the core up. lowest wake-up latency, burns 100% of a core even when idle,
+//              only makes sense when the thread is pinned to a core nothing else uses
+//   Backoff  - spin for a bit, then start yielding, then sleep in short naps. costs a few
+//              microseconds of wake-up latency once it's backed off but doesn't starve anyone
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+enum class WaitStrategy : uint8_t {
+    BusySpin = 0,
+    Backoff  = 1
+};
+
+// tells the cpu we're in a spin loop - on x86 this is PAUSE, which stops the spin from
+// hammering the memory pipeline and gives the other hyperthread some room
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// best effort - if pinning fails (not enough cores, no permission) the thread still runs, just unpinned
+inline void pin_this_thread(uint32_t core) {
+#ifdef __linux__
+    unsigned n = std::thread::hardware_concurrency();
+    if (n == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % n, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+// call idle() every time a poll comes back empty and reset() every time it gets something
+// keeps its own count of consecutive empty polls so the backoff escalates on its own
+class IdleWaiter {
+public:
+    explicit IdleWaiter(WaitStrategy strategy) : strategy_(strategy) {}
+
+    void reset() { idle_polls_ = 0; }
+
+    void idle() {
+        if (strategy_ == WaitStrategy::BusySpin) {
+            cpu_relax();
+            return;
+        }
+        ++idle_polls_;
+        if (idle_polls_ < SPIN_POLLS) {
+            cpu_relax();
+        } else if (idle_polls_ < SPIN_POLLS + YIELD_POLLS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(SLEEP_US));
+        }
+    }
+
+private:
+    static constexpr uint32_t SPIN_POLLS  = 1024; // ~a few microseconds of pure spinning
+    static constexpr uint32_t YIELD_POLLS = 256;
+    static constexpr uint32_t SLEEP_US    = 50;
+
+    WaitStrategy strategy_;
+    uint32_t idle_polls_ = 0;
+};
@@ -0,0 +1,729 @@
+// bench.cpp - the scenario benchmark suite (orderbook_bench)
+// main.cpp's benchmarks each print one hard-coded workload to stdout. this runs a set of named
+// workloads the same way every time - fixed seeds, warm-up passes, repeated timed passes,
+// optionally pinned to a core - and can write the results as JSON and diff them against a
+// baseline run, so a change can be checked for regressions instead of eyeballed.
+//
+//   orderbook_bench                              run every scenario, print a table
+//   orderbook_bench --list                       what the scenarios are
+//   orderbook_bench --scenario deep_passive,fok_heavy --reps 5 --cpu 2
+//   orderbook_bench --json after.json --compare before.json --threshold 5
+//   orderbook_bench --compare before.json --current after.json   (no run, just diff two files)
+//   orderbook_bench --scenario replay --replay session.jrnl      (replay a recorded journal)
+//
+// each scenario is a pre-built input: some orders to load untimed (the starting book) and a
+// stream of Commands. every timed pass gets a fresh book, loads it, then either applies the
+// whole stream back to back (throughput) or applies it with rdtsc around every command
+// (latency percentiles - these include the cost of the timer itself, printed as timer_ns).
+// --compare exits with status 1 if any scenario got slower than the threshold allows.
+
+#include "OrderBook.h"
+#include "Command.h"
+#include "Journal.h"
+#include "LatencyStats.h"
+#include "MappedFile.h"
+#include "WaitStrategy.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Workload {
+    std::vector<Command> initial; // applied to every fresh book before timing starts
+    std::vector<Command> ops;     // the timed part
+};
+
+// builds a workload against a scratch book, so cancels can always name an order that's
+// actually resting at that point in the stream (same IDs the timed books will hand out)
+class WorkloadBuilder {
+public:
+    WorkloadBuilder(Workload& w, uint64_t seed) : gen(seed), w_(w) {}
+
+    std::mt19937_64 gen;
+
+    void preload(const Order& o) {
+        w_.initial.push_back(Command::new_order(0, o));
+        track(book_.process_order(o));
+    }
+    void preload_stop(const Order& o, int32_t trigger) {
+        w_.initial.push_back(Command::stop(0, o, trigger));
+        book_.place_stop(o, trigger);
+    }
+    void add(const Order& o) {
+        w_.ops.push_back(Command::new_order(0, o));
+        track(book_.process_order(o));
+    }
+    void add_iceberg(const Order& o, uint32_t display) {
+        w_.ops.push_back(Command::iceberg(0, o, display));
+        track(book_.process_iceberg(o, display));
+    }
+    // cancel a random resting order - returns false (and adds nothing) if there isn't one
+    bool cancel_random() {
+        while (!live_.empty()) {
+            size_t idx = std::uniform_int_distribution<size_t>(0, live_.size() - 1)(gen);
+            uint64_t id = live_[idx];
+            live_[idx] = live_.back();
+            live_.pop_back();
+            if (book_.cancel_order(id)) { // skip the ones that have since been filled
+                w_.ops.push_back(Command::cancel(0, id));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // helpers for the generators
+    bool chance(double p) { return std::uniform_real_distribution<double>(0.0, 1.0)(gen) < p; }
+    int64_t uniform(int64_t lo, int64_t hi) { return std::uniform_int_distribution<int64_t>(lo, hi)(gen); }
+    OrderSide side() { return (gen() & 1) ? OrderSide::Buy : OrderSide::Sell; }
+    // a limit that rests `lo`..`hi` ticks away from mid on its own side - never crosses
+    Order passive(int32_t mid, int32_t lo, int32_t hi, uint64_t qty) {
+        OrderSide s = side();
+        int32_t off = static_cast<int32_t>(uniform(lo, hi));
+        return Order(s, OrderType::Limit, s == OrderSide::Buy ? mid - off : mid + off, qty);
+    }
+
+private:
+    Workload& w_;
+    OrderBook book_;
+    std::vector<uint64_t> live_;
+
+    void track(const ProcessOrderResult& r) {
+        if (r.new_order_id != 0) live_.push_back(r.new_order_id);
+    }
+};
+
+// ---------------------------------------------------------------------------------------------
+// scenarios
+
+static void build_mixed(WorkloadBuilder& b, size_t ops) {
+    // the run_performance_benchmark flow - random-walk mid, prices N(mid, 5 ticks),
+    // 40% limit / 20% market / 20% IoC / 20% FOK, 20% of ops cancel a live order
+    std::normal_distribution<double> offset(0.0, 5.0);
+    int32_t mid = 10000;
+    for (size_t i = 0; i < ops; ++i) {
+        mid = std::clamp<int32_t>(mid + static_cast<int32_t>(b.uniform(-1, 1)), 9000, 11000);
+        if (b.chance(0.20) && b.cancel_random()) continue;
+        int t = static_cast<int>(b.uniform(0, 4));
+        OrderType type = t <= 1 ? OrderType::Limit : t == 2 ? OrderType::Market : t == 3 ? OrderType::IoC : OrderType::FOK;
+        int32_t price = type == OrderType::Market ? 0 : std::max<int32_t>(1, static_cast<int32_t>(std::lround(mid + offset(b.gen))));
+        b.add(Order(b.side(), type, price, static_cast<uint64_t>(b.uniform(1, 100))));
+    }
+}
+
+static void build_deep_passive(WorkloadBuilder& b, size_t ops) {
+    // 1M orders resting over 1000 ticks a side - far bigger than cache - then passive adds and
+    // cancels of random live orders. nothing ever trades; this is all lookup / level / queue work
+    for (int i = 0; i < 1'000'000; ++i) b.preload(b.passive(10000, 1, 1000, static_cast<uint64_t>(b.uniform(1, 100))));
+    for (size_t i = 0; i < ops; ++i) {
+        if (b.chance(0.30) && b.cancel_random()) continue;
+        b.add(b.passive(10000, 1, 1000, static_cast<uint64_t>(b.uniform(1, 100))));
+    }
+}
+
+static void build_cancel_storm(WorkloadBuilder& b, size_t ops) {
+    // deep queues near the touch, then 90% cancels - a market maker pulling quotes
+    for (int i = 0; i < 500'000; ++i) b.preload(b.passive(10000, 1, 50, static_cast<uint64_t>(b.uniform(1, 100))));
+    for (size_t i = 0; i < ops; ++i) {
+        if (b.chance(0.90) && b.cancel_random()) continue;
+        b.add(b.passive(10000, 1, 50, static_cast<uint64_t>(b.uniform(1, 100))));
+    }
+}
+
+static void build_aggressive_sweeps(WorkloadBuilder& b, size_t ops) {
+    // passive flow keeps refilling the top 50 ticks, a quarter of the ops are big IoCs that
+    // take out several levels at once
+    for (int i = 0; i < 200'000; ++i) b.preload(b.passive(10000, 1, 50, static_cast<uint64_t>(b.uniform(1, 100))));
+    for (size_t i = 0; i < ops; ++i) {
+        if (b.chance(0.25)) {
+            OrderSide s = b.side();
+            int32_t through = static_cast<int32_t>(b.uniform(5, 20));
+            b.add(Order(s, OrderType::IoC, s == OrderSide::Buy ? 10000 + through : 10000 - through,
+                        static_cast<uint64_t>(b.uniform(500, 5000))));
+        } else {
+            b.add(b.passive(10000, 1, 50, static_cast<uint64_t>(b.uniform(1, 100))));
+        }
+    }
+}
+
+static void build_fok_heavy(WorkloadBuilder& b, size_t ops) {
+    // half the flow is FOK - mostly too big to fill (killed after the dry run), some filled
+    for (int i = 0; i < 100'000; ++i) b.preload(b.passive(10000, 1, 50, static_cast<uint64_t>(b.uniform(1, 100))));
+    for (size_t i = 0; i < ops; ++i) {
+        double r = std::uniform_real_distribution<double>(0.0, 1.0)(b.gen);
+        if (r < 0.50) {
+            OrderSide s = b.side();
+            int32_t through = static_cast<int32_t>(b.uniform(0, 20));
+            b.add(Order(s, OrderType::FOK, s == OrderSide::Buy ? 10000 + through : 10000 - through,
+                        static_cast<uint64_t>(b.uniform(100, 20000))));
+        } else if (r < 0.60 && b.cancel_random()) {
+            continue;
+        } else {
+            b.add(b.passive(10000, 1, 50, static_cast<uint64_t>(b.uniform(1, 100))));
+        }
+    }
+}
+
+static void build_wide_band(WorkloadBuilder& b, size_t ops) {
+    // prices spread over +-40000 ticks - ten times the ladder's default band, so it has to
+    // re-centre / widen, and the bitmap searches cover a lot of empty space
+    for (size_t i = 0; i < ops; ++i) {
+        double r = std::uniform_real_distribution<double>(0.0, 1.0)(b.gen);
+        if (r < 0.20 && b.cancel_random()) continue;
+        if (r < 0.40) {
+            OrderSide s = b.side();
+            b.add(Order(s, OrderType::IoC, static_cast<int32_t>(50000 + b.uniform(-40000, 40000)),
+                        static_cast<uint64_t>(b.uniform(1, 200))));
+        } else {
+            b.add(b.passive(50000, 1, 40000, static_cast<uint64_t>(b.uniform(1, 100))));
+        }
+    }
+}
+
+static void build_dormant_stops(WorkloadBuilder& b, size_t ops) {
+    // the mixed flow with 100k stops parked well outside where it trades (buy stops 30-50% above,
+    // sell stops 30-50% below) - none ever fire, so against `mixed` this is what it costs every
+    // trade to check for them
+    for (int i = 0; i < 100'000; ++i) {
+        OrderSide s = b.side();
+        int32_t trigger = static_cast<int32_t>(s == OrderSide::Buy ? b.uniform(13000, 15000) : b.uniform(5000, 7000));
+        OrderType fires_as = b.chance(0.5) ? OrderType::Market : OrderType::Limit;
+        b.preload_stop(Order(s, fires_as, trigger, static_cast<uint64_t>(b.uniform(1, 100))), trigger);
+    }
+    build_mixed(b, ops);
+}
+
+static void build_icebergs(WorkloadBuilder& b, size_t ops) {
+    // the mixed flow, but half its limit orders are icebergs of 100-1000 showing 5-20 - lots of
+    // slices filling and refilling at the back of their level
+    std::normal_distribution<double> offset(0.0, 5.0);
+    int32_t mid = 10000;
+    for (size_t i = 0; i < ops; ++i) {
+        mid = std::clamp<int32_t>(mid + static_cast<int32_t>(b.uniform(-1, 1)), 9000, 11000);
+        if (b.chance(0.20) && b.cancel_random()) continue;
+        int t = static_cast<int>(b.uniform(0, 4));
+        OrderType type = t <= 1 ? OrderType::Limit : t == 2 ? OrderType::Market : t == 3 ? OrderType::IoC : OrderType::FOK;
+        int32_t price = type == OrderType::Market ? 0 : std::max<int32_t>(1, static_cast<int32_t>(std::lround(mid + offset(b.gen))));
+        if (type == OrderType::Limit && b.chance(0.5)) {
+            b.add_iceberg(Order(b.side(), OrderType::Iceberg, price, static_cast<uint64_t>(b.uniform(100, 1000))),
+                          static_cast<uint32_t>(b.uniform(5, 20)));
+        } else {
+            b.add(Order(b.side(), type, price, static_cast<uint64_t>(b.uniform(1, 100))));
+        }
+    }
+}
+
+static void build_small_fills(WorkloadBuilder& b, size_t ops) {
+    // a book of 1-lot orders and market orders that eat 5-10 of them each - lots of trades per
+    // op, so this is mostly the fill loop, the trade log and pool returns
+    for (int i = 0; i < 500'000; ++i) b.preload(b.passive(10000, 1, 20, 1));
+    for (size_t i = 0; i < ops; ++i) {
+        double r = std::uniform_real_distribution<double>(0.0, 1.0)(b.gen);
+        if (r < 0.05 && b.cancel_random()) continue;
+        if (r < 0.15) {
+            b.add(Order(b.side(), OrderType::Market, 0, static_cast<uint64_t>(b.uniform(5, 10))));
+        } else {
+            b.add(b.passive(10000, 1, 20, 1));
+        }
+    }
+}
+
+// replay: every record in a journal file, in order. without --replay it records
+// the mixed flow through a Journal first and replays that
+static std::string replay_path;
+
+static void load_journal(const std::string& path, Workload& w) {
+    MappedFile file(path);
+    const JournalHeader* header = reinterpret_cast<const JournalHeader*>(file.data());
+    if (file.size() < sizeof(JournalHeader) || std::memcmp(header->magic, "OBJRNL01", 8) != 0 ||
+        header->record_size != sizeof(JournalRecord)) {
+        throw std::runtime_error(path + " is not a journal!");
+    }
+    const JournalRecord* records = reinterpret_cast<const JournalRecord*>(file.data() + sizeof(JournalHeader));
+    const uint64_t fits = (file.size() - sizeof(JournalHeader)) / sizeof(JournalRecord);
+    uint64_t expire_time = 0; // an Expiry record applies to the New after it
+    uint32_t owner = 0;       // an Owner record to the New / Stop / Iceberg after it
+    for (uint64_t i = 0; i < fits && records[i].type != JournalRecordType::End; ++i) {
+        const JournalRecord& r = records[i];
+        if (r.type == JournalRecordType::New) {
+            Order o(r.side, r.order_type, r.price, r.quantity);
+            w.ops.push_back(expire_time || owner ? Command::new_order(0, o, expire_time ? TimeInForce::GTT : TimeInForce::GTC,
+                                                                      expire_time, owner)
+                                                 : Command::new_order(0, o));
+            expire_time = 0;
+            owner = 0;
+        } else if (r.type == JournalRecordType::Expiry) {
+            expire_time = r.order_id;
+        } else if (r.type == JournalRecordType::Owner) {
+            owner = static_cast<uint32_t>(r.order_id);
+        } else if (r.type == JournalRecordType::MassCancel) {
+            const uint32_t by = static_cast<uint32_t>(r.order_id);
+            if (by == 0)         w.ops.push_back(Command::mass_cancel(0, r.side, r.price, static_cast<int32_t>(static_cast<int64_t>(r.quantity))));
+            else if (r.reserved) w.ops.push_back(Command::mass_cancel(0, by, r.side));
+            else                 w.ops.push_back(Command::mass_cancel(0, by));
+        } else if (r.type == JournalRecordType::Clock) {
+            w.ops.push_back(Command::clock(0, r.order_id));
+        } else if (r.type == JournalRecordType::Stop) {
+            w.ops.push_back(Command::stop(0, Order(r.side, r.order_type, r.price, r.quantity),
+                                          static_cast<int32_t>(static_cast<int64_t>(r.order_id)), owner));
+            owner = 0;
+        } else if (r.type == JournalRecordType::Auction) {
+            w.ops.push_back(Command::start_auction(0));
+        } else if (r.type == JournalRecordType::Uncross) {
+            w.ops.push_back(Command::uncross(0, r.price));
+        } else if (r.type == JournalRecordType::Iceberg) {
+            w.ops.push_back(Command::iceberg(0, Order(r.side, r.order_type, r.price, r.quantity),
+                                             static_cast<uint32_t>(r.order_id), owner));
+            owner = 0;
+        } else if (r.type == JournalRecordType::Cancel) {
+            w.ops.push_back(Command::cancel(0, r.order_id));
+        } else {
+            w.ops.push_back(Command::modify(0, r.order_id, r.price, r.quantity));
+        }
+    }
+}
+
+static void build_replay(WorkloadBuilder& b, size_t ops, Workload& w) {
+    if (!replay_path.empty()) {
+        load_journal(replay_path, w);
+        return;
+    }
+    Workload recorded;
+    WorkloadBuilder rb(recorded, 42);
+    build_mixed(rb, ops);
+    auto path = std::filesystem::temp_directory_path() / "orderbook_bench_replay.jrnl";
+    std::filesystem::remove(path);
+    {
+        Journal journal(JournalConfig{path.string()});
+        OrderBook book;
+        book.set_journal(&journal);
+        for (const Command& cmd : recorded.ops) {
+            if (cmd.type == CommandType::New) book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+            else book.cancel_order(cmd.order_id);
+        }
+        book.set_journal(nullptr);
+    }
+    load_journal(path.string(), w);
+    std::filesystem::remove(path);
+    (void)b;
+}
+
+struct Scenario {
+    const char* name;
+    const char* description;
+    std::function<void(Workload&, size_t)> build;
+};
+
+static std::vector<Scenario> scenarios() {
+    auto simple = [](void (*fn)(WorkloadBuilder&, size_t), uint64_t seed) {
+        return [fn, seed](Workload& w, size_t ops) {
+            WorkloadBuilder b(w, seed);
+            fn(b, ops);
+        };
+    };
+    return {
+        {"mixed",             "main.cpp's benchmark flow: N(mid,5) prices, all order types, 20% cancels", simple(build_mixed, 42)},
+        {"deep_passive",      "1M resting orders over 2000 ticks, passive adds + 30% cancels, no trades", simple(build_deep_passive, 1)},
+        {"cancel_storm",      "500k orders near the touch, 90% cancels",                                  simple(build_cancel_storm, 2)},
+        {"aggressive_sweeps", "passive refill + 25% large IoCs sweeping several levels",                 simple(build_aggressive_sweeps, 3)},
+        {"fok_heavy",         "50% FOK (mostly killed), passive adds, 10% cancels",                       simple(build_fok_heavy, 4)},
+        {"wide_band",         "prices over +-40000 ticks - band re-centring and sparse bitmap searches",  simple(build_wide_band, 5)},
+        {"dormant_stops",     "the mixed flow with 100k stops waiting far outside it - never fire",       simple(build_dormant_stops, 42)},
+        {"icebergs",          "the mixed flow with half the limits as icebergs (100-1000 showing 5-20)",  simple(build_icebergs, 42)},
+        {"small_fills",       "1-lot book hit by 5-10 lot market orders - many trades per op",            simple(build_small_fills, 6)},
+        {"replay",            "replays a recorded journal (--replay FILE, or a freshly recorded mixed flow)",
+            [](Workload& w, size_t ops) { WorkloadBuilder b(w, 7); build_replay(b, ops, w); }},
+    };
+}
+
+// ---------------------------------------------------------------------------------------------
+// running
+
+static void apply(OrderBook& book, const Command& cmd) {
+    switch (cmd.type) {
+        case CommandType::New:
+            if (cmd.tif == TimeInForce::GTC && cmd.owner == 0) book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+            else book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity), cmd.tif, cmd.expire_time, cmd.owner);
+            break;
+        case CommandType::Cancel: book.cancel_order(cmd.order_id); break;
+        case CommandType::Modify: book.modify_order(cmd.order_id, cmd.price, cmd.quantity); break;
+        case CommandType::Stop:
+            book.place_stop(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity), cmd.trigger_price,
+                            cmd.owner);
+            break;
+        case CommandType::Iceberg:
+            book.process_iceberg(Order(cmd.side, OrderType::Iceberg, cmd.price, cmd.quantity), cmd.display_quantity,
+                                 cmd.owner);
+            break;
+        case CommandType::AuctionStart: book.start_auction(); break;
+        case CommandType::Uncross:      book.uncross(cmd.price); break;
+        case CommandType::Clock:        book.advance_time(cmd.now); break;
+        case CommandType::MassCancel:   book.mass_cancel(cmd); break;
+    }
+}
+
+static void load_initial(OrderBook& book, const Workload& w) {
+    for (const Command& cmd : w.initial) apply(book, cmd);
+}
+
+static double throughput_pass(const Workload& w) {
+    OrderBook book;
+    load_initial(book, w);
+    auto start = std::chrono::steady_clock::now();
+    for (const Command& cmd : w.ops) apply(book, cmd);
+    auto end = std::chrono::steady_clock::now();
+    return w.ops.size() / std::chrono::duration<double>(end - start).count();
+}
+
+static void latency_pass(const Workload& w, LatencyHistogramData& hist) {
+    OrderBook book;
+    load_initial(book, w);
+    for (const Command& cmd : w.ops) {
+        uint64_t t0 = tsc_now();
+        apply(book, cmd);
+        hist.add(tsc_now() - t0);
+    }
+}
+
+struct ScenarioResult {
+    std::string name;
+    uint64_t initial = 0;
+    uint64_t ops = 0;
+    double tput_median = 0, tput_min = 0, tput_max = 0; // ops/sec
+    double mean_ns = 0, p50_ns = 0, p90_ns = 0, p99_ns = 0, p999_ns = 0, max_ns = 0;
+};
+
+struct Options {
+    std::vector<std::string> scenarios;
+    size_t ops = 1'000'000;
+    int warmup = 1;
+    int reps = 3;
+    int cpu = -1;
+    std::string json_path;
+    std::string compare_path;
+    std::string current_path;
+    double threshold = 5.0; // percent
+    bool list = false;
+};
+
+static ScenarioResult run_scenario(const Scenario& s, const Options& opt) {
+    Workload w;
+    s.build(w, opt.ops);
+
+    for (int i = 0; i < opt.warmup; ++i) throughput_pass(w);
+
+    std::vector<double> tput;
+    LatencyHistogramData hist;
+    for (int i = 0; i < opt.reps; ++i) {
+        tput.push_back(throughput_pass(w));
+        latency_pass(w, hist);
+    }
+    std::sort(tput.begin(), tput.end());
+
+    const double tpn = tsc_ticks_per_ns();
+    ScenarioResult r;
+    r.name = s.name;
+    r.initial = w.initial.size();
+    r.ops = w.ops.size();
+    r.tput_median = tput[tput.size() / 2];
+    r.tput_min = tput.front();
+    r.tput_max = tput.back();
+    r.mean_ns = hist.count ? hist.sum / tpn / hist.count : 0.0;
+    r.p50_ns  = hist.percentile(0.50) / tpn;
+    r.p90_ns  = hist.percentile(0.90) / tpn;
+    r.p99_ns  = hist.percentile(0.99) / tpn;
+    r.p999_ns = hist.percentile(0.999) / tpn;
+    r.max_ns  = hist.max / tpn;
+    return r;
+}
+
+// ---------------------------------------------------------------------------------------------
+// JSON out / in - just enough for our own result files
+
+static double timer_overhead_ns() {
+    const int N = 1'000'000;
+    uint64_t t0 = tsc_now();
+    for (int i = 0; i < N; ++i) tsc_now();
+    return (tsc_now() - t0) / tsc_ticks_per_ns() / N;
+}
+
+static void write_json(std::ostream& os, const std::vector<ScenarioResult>& results, const Options& opt) {
+    char buf[512];
+    os << "{\n  \"schema\": 1,\n";
+    std::snprintf(buf, sizeof(buf),
+                  "  \"config\": {\"ops\": %zu, \"warmup\": %d, \"reps\": %d, \"cpu\": %d, \"tsc_ticks_per_ns\": %.4f, \"timer_ns\": %.2f},\n",
+                  opt.ops, opt.warmup, opt.reps, opt.cpu, tsc_ticks_per_ns(), timer_overhead_ns());
+    os << buf << "  \"scenarios\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ScenarioResult& r = results[i];
+        std::snprintf(buf, sizeof(buf),
+                      "    {\"name\": \"%s\", \"initial_orders\": %llu, \"ops\": %llu,\n"
+                      "     \"throughput\": {\"median\": %.0f, \"min\": %.0f, \"max\": %.0f},\n"
+                      "     \"latency_ns\": {\"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"p99_9\": %.1f, \"max\": %.1f}}%s\n",
+                      r.name.c_str(), static_cast<unsigned long long>(r.initial), static_cast<unsigned long long>(r.ops),
+                      r.tput_median, r.tput_min, r.tput_max,
+                      r.mean_ns, r.p50_ns, r.p90_ns, r.p99_ns, r.p999_ns, r.max_ns,
+                      i + 1 < results.size() ? "," : "");
+        os << buf;
+    }
+    os << "  ]\n}\n";
+}
+
+struct JsonValue {
+    enum Type { Null, Number, String, Array, Object } type = Null;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;      // Array elements, or Object values
+    std::vector<std::string> keys;     // Object keys, parallel to items
+
+    const JsonValue* get(const std::string& key) const {
+        for (size_t i = 0; i < keys.size(); ++i) if (keys[i] == key) return &items[i];
+        return nullptr;
+    }
+    double num(const std::string& key) const {
+        const JsonValue* v = get(key);
+        return v && v->type == Number ? v->number : 0.0;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : s_(text) {}
+
+    JsonValue parse() {
+        JsonValue v = value();
+        skip_ws();
+        if (pos_ != s_.size()) fail();
+        return v;
+    }
+
+private:
+    const std::string& s_;
+    size_t pos_ = 0;
+
+    [[noreturn]] void fail() { throw std::runtime_error("Bad JSON at offset " + std::to_string(pos_) + "!"); }
+    void skip_ws() { while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_]))) ++pos_; }
+    void expect(char c) {
+        skip_ws();
+        if (pos_ >= s_.size() || s_[pos_] != c) fail();
+        ++pos_;
+    }
+    bool peek(char c) {
+        skip_ws();
+        return pos_ < s_.size() && s_[pos_] == c;
+    }
+
+    std::string str() {
+        expect('"');
+        std::string out;
+        while (pos_ < s_.size() && s_[pos_] != '"') {
+            if (s_[pos_] == '\\' && pos_ + 1 < s_.size()) ++pos_; // our files never need more than this
+            out += s_[pos_++];
+        }
+        expect('"');
+        return out;
+    }
+
+    JsonValue value() {
+        skip_ws();
+        if (pos_ >= s_.size()) fail();
+        JsonValue v;
+        char c = s_[pos_];
+        if (c == '{') {
+            v.type = JsonValue::Object;
+            ++pos_;
+            if (peek('}')) { ++pos_; return v; }
+            do {
+                v.keys.push_back(str());
+                expect(':');
+                v.items.push_back(value());
+            } while (peek(',') && ++pos_);
+            expect('}');
+        } else if (c == '[') {
+            v.type = JsonValue::Array;
+            ++pos_;
+            if (peek(']')) { ++pos_; return v; }
+            do {
+                v.items.push_back(value());
+            } while (peek(',') && ++pos_);
+            expect(']');
+        } else if (c == '"') {
+            v.type = JsonValue::String;
+            v.string = str();
+        } else if (s_.compare(pos_, 4, "null") == 0) {
+            pos_ += 4;
+        } else {
+            size_t used = 0;
+            v.type = JsonValue::Number;
+            v.number = std::stod(s_.substr(pos_, 32), &used);
+            if (used == 0) fail();
+            pos_ += used;
+        }
+        return v;
+    }
+};
+
+static std::vector<ScenarioResult> read_results(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Could not open " + path + "!");
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string text = ss.str();
+    JsonValue root = JsonParser(text).parse();
+    const JsonValue* list = root.get("scenarios");
+    if (!list || list->type != JsonValue::Array) throw std::runtime_error(path + " has no scenarios!");
+
+    std::vector<ScenarioResult> out;
+    for (const JsonValue& s : list->items) {
+        ScenarioResult r;
+        const JsonValue* name = s.get("name");
+        r.name = name ? name->string : "";
+        r.initial = static_cast<uint64_t>(s.num("initial_orders"));
+        r.ops = static_cast<uint64_t>(s.num("ops"));
+        if (const JsonValue* t = s.get("throughput")) {
+            r.tput_median = t->num("median");
+            r.tput_min = t->num("min");
+            r.tput_max = t->num("max");
+        }
+        if (const JsonValue* l = s.get("latency_ns")) {
+            r.mean_ns = l->num("mean");
+            r.p50_ns = l->num("p50");
+            r.p90_ns = l->num("p90");
+            r.p99_ns = l->num("p99");
+            r.p999_ns = l->num("p99_9");
+            r.max_ns = l->num("max");
+        }
+        out.push_back(r);
+    }
+    return out;
+}
+
+// a scenario regresses if median throughput dropped, or p99 rose, by more than threshold percent
+static int compare(const std::vector<ScenarioResult>& base, const std::vector<ScenarioResult>& cur, double threshold) {
+    int regressions = 0;
+    std::printf("\n%-18s %14s %14s %8s   %10s %10s %8s\n", "scenario", "base ops/s", "ops/s", "change", "base p99", "p99", "change");
+    for (const ScenarioResult& c : cur) {
+        auto it = std::find_if(base.begin(), base.end(), [&](const ScenarioResult& b) { return b.name == c.name; });
+        if (it == base.end()) {
+            std::printf("%-18s (not in baseline)\n", c.name.c_str());
+            continue;
+        }
+        double dt = it->tput_median > 0 ? (c.tput_median / it->tput_median - 1.0) * 100.0 : 0.0;
+        double dl = it->p99_ns > 0 ? (c.p99_ns / it->p99_ns - 1.0) * 100.0 : 0.0;
+        bool bad = dt < -threshold || dl > threshold;
+        regressions += bad;
+        std::printf("%-18s %14.0f %14.0f %+7.1f%%   %10.1f %10.1f %+7.1f%%%s\n", c.name.c_str(),
+                    it->tput_median, c.tput_median, dt, it->p99_ns, c.p99_ns, dl, bad ? "  REGRESSION" : "");
+    }
+    std::printf("%d regression(s) at a %.1f%% threshold\n", regressions, threshold);
+    return regressions;
+}
+
+// ---------------------------------------------------------------------------------------------
+
+static void usage() {
+    std::puts("usage: orderbook_bench [--list] [--scenario a,b,...] [--ops N] [--warmup N] [--reps N] [--cpu K]\n"
+              "                       [--replay JOURNAL] [--json FILE|-] [--compare BASELINE.json [--current FILE]]\n"
+              "                       [--threshold PCT]");
+}
+
+static Options parse_args(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + a + "!");
+            return argv[++i];
+        };
+        if (a == "--list") opt.list = true;
+        else if (a == "--scenario") {
+            std::stringstream ss(next());
+            std::string name;
+            while (std::getline(ss, name, ',')) if (!name.empty()) opt.scenarios.push_back(name);
+        }
+        else if (a == "--ops")       opt.ops = std::stoull(next());
+        else if (a == "--warmup")    opt.warmup = std::stoi(next());
+        else if (a == "--reps")      opt.reps = std::max(1, std::stoi(next()));
+        else if (a == "--cpu")       opt.cpu = std::stoi(next());
+        else if (a == "--replay")    replay_path = next();
+        else if (a == "--json")      opt.json_path = next();
+        else if (a == "--compare")   opt.compare_path = next();
+        else if (a == "--current")   opt.current_path = next();
+        else if (a == "--threshold") opt.threshold = std::stod(next());
+        else if (a == "--help" || a == "-h") { usage(); std::exit(0); }
+        else throw std::runtime_error("Unknown option " + a + " (see --help)!");
+    }
+    return opt;
+}
+
+int main(int argc, char** argv) {
+    try {
+        Options opt = parse_args(argc, argv);
+        const std::vector<Scenario> all = scenarios();
+
+        if (opt.list) {
+            for (const Scenario& s : all) std::printf("  %-18s %s\n", s.name, s.description);
+            return 0;
+        }
+
+        // diff two existing result files, no run
+        if (!opt.compare_path.empty() && !opt.current_path.empty()) {
+            return compare(read_results(opt.compare_path), read_results(opt.current_path), opt.threshold) ? 1 : 0;
+        }
+
+        std::vector<const Scenario*> selected;
+        for (const Scenario& s : all) {
+            if (opt.scenarios.empty() || std::find(opt.scenarios.begin(), opt.scenarios.end(), s.name) != opt.scenarios.end()) {
+                selected.push_back(&s);
+            }
+        }
+        for (const std::string& name : opt.scenarios) {
+            if (std::none_of(all.begin(), all.end(), [&](const Scenario& s) { return name == s.name; })) {
+                throw std::runtime_error("Unknown scenario " + name + " (see --list)!");
+            }
+        }
+
+        if (opt.cpu >= 0) pin_this_thread(static_cast<uint32_t>(opt.cpu));
+
+        // when the JSON goes to stdout the table goes to stderr, so the output stays parseable
+        FILE* table = opt.json_path == "-" ? stderr : stdout;
+        std::fprintf(table, "%-18s %10s %14s %14s %9s %9s %9s %9s %10s\n", "scenario", "ops", "median ops/s",
+                     "min ops/s", "mean ns", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+        std::vector<ScenarioResult> results;
+        for (const Scenario* s : selected) {
+            ScenarioResult r = run_scenario(*s, opt);
+            std::fprintf(table, "%-18s %10llu %14.0f %14.0f %9.1f %9.1f %9.1f %9.1f %10.1f\n", r.name.c_str(),
+                         static_cast<unsigned long long>(r.ops), r.tput_median, r.tput_min,
+                         r.mean_ns, r.p50_ns, r.p99_ns, r.p999_ns, r.max_ns);
+            std::fflush(table);
+            results.push_back(r);
+        }
+
+        if (opt.json_path == "-") {
+            write_json(std::cout, results, opt);
+        } else if (!opt.json_path.empty()) {
+            std::ofstream out(opt.json_path);
+            if (!out) throw std::runtime_error("Could not write " + opt.json_path + "!");
+            write_json(out, results, opt);
+        }
+
+        if (!opt.compare_path.empty()) {
+            return compare(read_results(opt.compare_path), results, opt.threshold) ? 1 : 0;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+}
@@ -5,8 +5,22 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <tuple>
 #include "Order.h"
 #include "OrderBook.h"
+#include "MatchingEngine.h"
+#include "OrderBookRunner.h"
+#include "MappedFile.h"
+#include "ProtocolDecoder.h"
+#include "Journal.h"
+#include "ReplayRunner.h"
 
 // Displays a tick price as a dollar amount alongside the raw tick value
 static std::string fmt_price(int32_t ticks) {
@@ -76,8 +90,12 @@ void run_performance_benchmark() {
               << " – " << fmt_price(*std::max_element(mid_path.begin(), mid_path.end())) << "\n";
 
     // throughput benchmark - mix of adds and cancels
+    // keeps the full trade history like the original did, but spilled to a trade file behind the
+    // matching thread instead of in one giant vector
     {
-        OrderBook book;
+        OrderBookConfig config;
+        config.trade_log_path = (std::filesystem::temp_directory_path() / "orderbook_bench_trades.bin").string();
+        OrderBook book(config);
         std::vector<uint64_t> active_ids;
         active_ids.reserve(100'000);
 
@@ -123,6 +141,112 @@ void run_performance_benchmark() {
         std::cout << "  Total operations:         " << NUM_OPS       << "\n";
         std::cout << "  Time:                     " << elapsed        << " s\n";
         std::cout << "  Throughput:               " << static_cast<long long>(NUM_OPS / elapsed) << " ops/sec\n";
+        auto history = book.get_trade_history();
+        std::cout << "  Trades in history:        " << history.size() << " (" << history.dropped()
+                  << " dropped, ring full)\n";
+    }
+
+    // batched submission - the same add + cancel flow recorded as Commands (a pass on a scratch
+    // book decides which live order each cancel hits), then fed through a book both one
+    // process_order / cancel_order call at a time and in bursts through process_commands.
+    // the benchmark book stays small enough to live in cache, so it's run again on a deep book
+    // (1M resting orders over 2000 ticks, half adds / half cancels of random live orders) where
+    // every cancel misses on the lookup slot, the order and its neighbours - what the prefetch is for
+    {
+        const size_t BATCH = 64;
+        std::vector<Command> commands;
+        commands.reserve(NUM_OPS);
+        {
+            OrderBook book;
+            std::vector<uint64_t> active_ids;
+            std::uniform_real_distribution<double> uniform01(0.0, 1.0);
+            int order_idx = 0;
+            for (int i = 0; i < NUM_OPS; ++i) {
+                if (!active_ids.empty() && uniform01(gen) < CANCEL_RATIO) {
+                    int idx = (int)(uniform01(gen) * active_ids.size());
+                    commands.push_back(Command::cancel(0, active_ids[idx]));
+                    book.cancel_order(active_ids[idx]);
+                    active_ids[idx] = active_ids.back();
+                    active_ids.pop_back();
+                } else {
+                    const Order& o = orders[order_idx++ % NUM_OPS];
+                    commands.push_back(Command::new_order(0, o));
+                    auto result = book.process_order(o);
+                    if (result.new_order_id != 0) active_ids.push_back(result.new_order_id);
+                }
+            }
+        }
+
+        // nothing in the deep flow crosses, so the IDs are known without running it
+        const int DEEP_ORDERS = 1'000'000;
+        std::vector<Order> deep_book;
+        std::vector<Command> deep_commands;
+        {
+            std::uniform_int_distribution<int32_t>  offset_dist(1, 1000);
+            std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+            std::uniform_int_distribution<int>      coin(0, 1);
+            auto passive = [&](bool buy) {
+                return Order(buy ? OrderSide::Buy : OrderSide::Sell, OrderType::Limit,
+                             buy ? 10000 - offset_dist(gen) : 10000 + offset_dist(gen), qty_dist(gen));
+            };
+            std::vector<uint64_t> live;
+            for (int i = 0; i < DEEP_ORDERS; ++i) {
+                deep_book.push_back(passive((i & 1) == 0));
+                live.push_back(i + 1);
+            }
+            uint64_t next_id = DEEP_ORDERS + 1;
+            for (int i = 0; i < NUM_OPS; ++i) {
+                if (coin(gen)) {
+                    size_t idx = std::uniform_int_distribution<size_t>(0, live.size() - 1)(gen);
+                    deep_commands.push_back(Command::cancel(0, live[idx]));
+                    live[idx] = live.back();
+                    live.pop_back();
+                } else {
+                    deep_commands.push_back(Command::new_order(0, passive(coin(gen) == 1)));
+                    live.push_back(next_id++);
+                }
+            }
+        }
+
+        // both ways through the same book, alternating bursts: even bursts one call at a time, odd
+        // ones through process_commands, then again with the parity swapped. two separate books
+        // (the first version of this) came out up to ~10% apart on identical work here, from
+        // where each one's memory landed - more than the difference being measured
+        auto time_flow = [&](const std::vector<Order>& initial, const std::vector<Command>& flow) {
+            double seconds[2] = {0.0, 0.0}; // [0] one call per op, [1] process_commands
+            for (size_t pass = 0; pass < 2; ++pass) {
+                OrderBook book;
+                ResultSink sink(BATCH, BATCH * 64);
+                for (const Order& o : initial) book.process_order(o);
+                for (size_t i = 0, burst = 0; i < flow.size(); i += BATCH, ++burst) {
+                    const size_t n = std::min(BATCH, flow.size() - i);
+                    const bool batched = ((burst + pass) & 1) != 0;
+                    auto start = std::chrono::high_resolution_clock::now();
+                    if (batched) {
+                        book.process_commands(std::span<const Command>(flow).subspan(i, n), sink);
+                    } else {
+                        for (const Command& cmd : std::span<const Command>(flow).subspan(i, n)) {
+                            if (cmd.type == CommandType::New) {
+                                book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+                            } else {
+                                book.cancel_order(cmd.order_id);
+                            }
+                        }
+                    }
+                    seconds[batched] += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                }
+            }
+            // each way handled half of two passes - one flow's worth
+            return std::pair<double, double>(flow.size() / seconds[0], flow.size() / seconds[1]);
+        };
+
+        std::cout << "\n=== Batched submission (bursts of " << BATCH << ") ===\n";
+        auto [single, batch] = time_flow({}, commands);
+        std::cout << "  benchmark flow, one call per op:  " << static_cast<long long>(single) << " ops/sec\n";
+        std::cout << "  benchmark flow, process_commands: " << static_cast<long long>(batch) << " ops/sec\n";
+        std::tie(single, batch) = time_flow(deep_book, deep_commands);
+        std::cout << "  deep book, one call per op:       " << static_cast<long long>(single) << " ops/sec\n";
+        std::cout << "  deep book, process_commands:      " << static_cast<long long>(batch) << " ops/sec\n";
     }
 
     // latency benchmark - times each individual add to get percentiles
@@ -156,6 +280,873 @@ void run_performance_benchmark() {
     }
 }
 
+// turns the pre-generated orders into a stream of New / Cancel commands spread over num_symbols books
+// every New uses up one order ID in its book (even if it's killed or filled), so we can work
+// out which IDs exist per symbol without seeing the results and cancel a random earlier one.
+// ids_issued comes back with how many IDs each symbol used
+static std::vector<Command> generate_commands(const std::vector<Order>& orders, uint32_t num_symbols,
+                                              double cancel_ratio, std::vector<uint64_t>& ids_issued,
+                                              std::mt19937& gen) {
+    std::vector<Command> commands;
+    commands.reserve(orders.size());
+    ids_issued.assign(num_symbols, 0);
+    std::uniform_int_distribution<uint32_t> symbol_dist(0, num_symbols - 1);
+    std::uniform_real_distribution<double> uniform01(0.0, 1.0);
+    for (const Order& o : orders) {
+        uint32_t sym = symbol_dist(gen);
+        if (ids_issued[sym] > 0 && uniform01(gen) < cancel_ratio) {
+            uint64_t id = 1 + static_cast<uint64_t>(uniform01(gen) * ids_issued[sym]);
+            commands.push_back(Command::cancel(sym, id));
+        } else {
+            commands.push_back(Command::new_order(sym, o));
+            ++ids_issued[sym];
+        }
+    }
+    return commands;
+}
+
+// the in-book latency histograms (LatencyStats.h) on the benchmark order flow - a breakdown by
+// operation and by trades generated, timed with rdtsc inside the book instead of a clock call
+// pair around it. only has anything to show when built with -DORDERBOOK_LATENCY_STATS
+void run_latency_breakdown() {
+    std::cout << "\n=== In-book latency histograms ===\n";
+    if constexpr (!LATENCY_STATS) {
+        std::cout << "  built without -DORDERBOOK_LATENCY_STATS - skipping\n";
+        return;
+    }
+
+    // what the two ways of timing cost on their own
+    const int TIMER_CALLS = 1'000'000;
+    // (neither call can be optimised away - rdtsc is a volatile asm, the clock is a library call)
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < TIMER_CALLS; ++i) tsc_now();
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < TIMER_CALLS; ++i) std::chrono::high_resolution_clock::now();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "  timer cost: rdtsc " << std::chrono::duration<double, std::nano>(mid - start).count() / TIMER_CALLS
+              << " ns, high_resolution_clock " << std::chrono::duration<double, std::nano>(end - mid).count() / TIMER_CALLS
+              << " ns\n";
+
+    const int NUM_OPS = 2'500'000;
+    std::mt19937 gen(42);
+    auto mid_path = generate_mid_path(NUM_OPS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+
+    OrderBook book;
+    for (const Command& cmd : commands) {
+        if (cmd.type == CommandType::New) {
+            book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+        } else {
+            book.cancel_order(cmd.order_id);
+        }
+    }
+
+    LatencySnapshot snap = book.latency_stats().snapshot();
+    std::cout << "  tsc: " << snap.ticks_per_ns << " ticks/ns\n";
+    auto row = [&](const char* label, const LatencyHistogramData& h) {
+        if (h.count == 0) return;
+        std::cout << "  " << std::left << std::setw(12) << label << std::right
+                  << std::setw(9) << h.count << "  mean " << std::setw(6) << std::fixed << std::setprecision(1) << snap.mean_ns(h)
+                  << "  p50 " << std::setw(6) << snap.percentile_ns(h, 0.50)
+                  << "  p99 " << std::setw(7) << snap.percentile_ns(h, 0.99)
+                  << "  p99.9 " << std::setw(7) << snap.percentile_ns(h, 0.999)
+                  << "  max " << std::setw(9) << snap.to_ns(h.max) << " ns\n" << std::defaultfloat;
+    };
+    row("limit rest", snap.op(LatencyOp::LimitRest));
+    row("sweep",      snap.op(LatencyOp::Sweep));
+    row("IoC",        snap.op(LatencyOp::IoC));
+    row("FOK kill",   snap.op(LatencyOp::FokKill));
+    row("FOK fill",   snap.op(LatencyOp::FokFill));
+    row("cancel",     snap.op(LatencyOp::Cancel));
+    const char* trade_labels[TRADE_CLASSES] = {"0 trades", "1 trade", "2-3 trades", "4-7 trades", "8-15 trades", "16+ trades"};
+    for (size_t i = 0; i < TRADE_CLASSES; ++i) row(trade_labels[i], snap.by_trades[i]);
+}
+
+// same order flow as run_performance_benchmark, but spread across lots of symbols and pushed
+// through MatchingEngine - one gateway thread (this one) feeding 1, 2, 4 ... shard threads.
+// every shard owns its own books so throughput should scale with the number of shard cores
+void run_multi_symbol_benchmark() {
+    const int NUM_OPS = 2'000'000;
+    const uint32_t NUM_SYMBOLS = 1000;
+    const double CANCEL_RATIO = 0.20;
+
+    std::mt19937 gen(7);
+    auto mid_path = generate_mid_path(NUM_OPS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+
+    // pre-build the command stream so the timed loop is just submit()
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, NUM_SYMBOLS, CANCEL_RATIO, ids_issued, gen);
+
+    // size each book for what one symbol actually sees instead of the 2.5M default
+    uint64_t max_per_symbol = *std::max_element(ids_issued.begin(), ids_issued.end());
+    OrderBookConfig book_config;
+    book_config.initial_orders = max_per_symbol + 1;
+    book_config.trade_history  = max_per_symbol * 2;
+    book_config.ladder_ticks   = 2048;
+    // a huge page per book would be 2 MB each for a few thousand orders - 4 KB pages here
+    book_config.huge_pages     = HugePages::None;
+    size_t book_bytes = book_config.initial_orders * (sizeof(Order) + sizeof(Order*))
+                      + book_config.trade_history * sizeof(Trade)
+                      + 2 * book_config.ladder_ticks * sizeof(PriceLevel);
+
+    std::cout << "\n=== Multi-symbol engine benchmark (" << NUM_SYMBOLS << " symbols, "
+              << NUM_OPS << " ops) ===\n";
+    std::cout << "  Per-book memory: ~" << book_bytes / 1024 << " KB (default config is ~"
+              << (OrderBookConfig{}.initial_orders * (sizeof(Order) + sizeof(Order*))
+                  + OrderBookConfig{}.trade_history * sizeof(Trade)) / (1024 * 1024) << " MB)\n";
+
+    // leave core 0 for this (gateway) thread where there's room to
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t max_shards = std::max(1u, cores - 1);
+    double base_throughput = 0.0;
+
+    for (uint32_t shards = 1; shards <= max_shards; shards *= 2) {
+        MatchingEngineConfig config;
+        config.num_shards  = shards;
+        config.num_symbols = NUM_SYMBOLS;
+        config.first_core  = cores > 1 ? 1 : 0;
+        config.book        = book_config;
+
+        MatchingEngine engine(config);
+        engine.start();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const Command& cmd : commands) {
+            while (!engine.submit(cmd)) std::this_thread::yield(); // shard is behind, let it catch up
+        }
+        engine.stop(); // waits for every shard to drain its inbox
+        auto end = std::chrono::high_resolution_clock::now();
+        double elapsed = std::chrono::duration<double>(end - start).count();
+
+        uint64_t trades = 0;
+        for (uint32_t s = 0; s < shards; ++s) trades += engine.shard_stats(s).trades;
+
+        double throughput = NUM_OPS / elapsed;
+        if (shards == 1) base_throughput = throughput;
+        std::cout << "  " << shards << " shard(s): " << static_cast<long long>(throughput) << " ops/sec"
+                  << "  (x" << std::setprecision(3) << throughput / base_throughput << std::setprecision(6)
+                  << " vs 1 shard, " << trades << " trades)\n";
+    }
+}
+
+// end-to-end latency through OrderBookRunner: this thread plays the gateway and stamps each
+// command as it's submitted, a second thread plays the report reader and stamps each Status event
+// as it comes off the egress ring. so every sample is ingress ring + matching + egress ring +
+// two cross-core cache line transfers. commands are paced so we measure the hand-off, not queueing
+void run_cross_thread_latency_benchmark() {
+    const int NUM_CMDS = 200'000;
+    const auto SEND_GAP = std::chrono::nanoseconds(2000); // 500k commands/sec
+
+    std::mt19937 gen(11);
+    auto mid_path = generate_mid_path(NUM_CMDS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+
+    auto now_ns = [] {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    };
+
+    std::cout << "\n=== Cross-thread latency (gateway -> OrderBookRunner -> reader, "
+              << NUM_CMDS << " cmds) ===\n";
+
+    for (WaitStrategy wait : {WaitStrategy::BusySpin, WaitStrategy::Backoff}) {
+        OrderBook book;
+        OrderBookRunnerConfig config;
+        config.wait = wait;
+        OrderBookRunner runner(book, config);
+
+        // sent_ns is written before the command goes into the ingress ring and read after its status
+        // comes out of the egress ring - the two release/acquire hand-offs make that safe
+        std::vector<uint64_t> sent_ns(NUM_CMDS);
+        std::vector<double> latencies_ns(NUM_CMDS);
+
+        runner.start();
+        std::thread reader([&] {
+            Event ev;
+            IdleWaiter waiter(wait);
+            for (int done = 0; done < NUM_CMDS;) {
+                if (!runner.poll(ev)) { waiter.idle(); continue; }
+                waiter.reset();
+                if (ev.type == EventType::Status) {
+                    latencies_ns[ev.seq] = static_cast<double>(now_ns() - sent_ns[ev.seq]);
+                    ++done;
+                }
+            }
+        });
+
+        auto next_send = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_CMDS; ++i) {
+            while (std::chrono::steady_clock::now() < next_send) std::this_thread::yield();
+            next_send += SEND_GAP;
+            sent_ns[i] = now_ns();
+            while (!runner.submit(commands[i])) std::this_thread::yield();
+        }
+        reader.join();
+        runner.stop();
+
+        std::sort(latencies_ns.begin(), latencies_ns.end());
+        double mean = std::accumulate(latencies_ns.begin(), latencies_ns.end(), 0.0) / NUM_CMDS;
+        std::cout << "  " << (wait == WaitStrategy::BusySpin ? "busy-spin:" : "backoff:  ")
+                  << std::fixed << std::setprecision(0)
+                  << " mean " << mean << " ns"
+                  << ", p50 " << latencies_ns[NUM_CMDS * 50 / 100] << " ns"
+                  << ", p99 " << latencies_ns[NUM_CMDS * 99 / 100] << " ns"
+                  << ", p99.9 " << latencies_ns[(int)(NUM_CMDS * 0.999)] << " ns"
+                  << ", max " << latencies_ns.back() << " ns\n"
+                  << std::defaultfloat << std::setprecision(6);
+    }
+}
+
+// strategy / risk threads watching the book through a TopOfBook while it matches. the matcher runs
+// the usual flow (20% cancels) with nothing attached, with a TopOfBook and no readers, and with
+// 1 / 2 / 4 reader threads spinning on read() the whole time - what they cost it is the cache
+// misses on the lines they keep pulling away. then, per reader, how stale what it sees is: how
+// long after a publish the reader first has that version (timed from the end of the call that
+// published it), and how many publishes it skipped over in between because it was mid-read
+void run_top_of_book_benchmark() {
+    const int NUM_CMDS = 2'000'000;
+    std::mt19937 gen(23);
+    auto mid_path = generate_mid_path(NUM_CMDS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    struct ReaderStats {
+        uint64_t reads = 0, retries = 0, new_versions = 0, skipped = 0;
+        std::vector<uint64_t> lag_ticks; // publish -> first read of that version
+    };
+
+    // stamps[v]: tsc when the call that published version v returned - only written when readers
+    // are timing lag. zeroed, so a reader that sees v before the matcher has stamped it waits
+    std::vector<std::atomic<uint64_t>> stamps(NUM_CMDS + 2);
+
+    // batch > 0 sends the flow through process_commands that many at a time - one publish per batch
+    auto run = [&](bool attach, size_t levels, int readers, bool stamp, std::vector<ReaderStats>& stats, size_t batch = 0) {
+        OrderBook book;
+        TopOfBook top(levels);
+        if (attach) book.set_top_of_book(&top);
+        for (auto& s : stamps) s.store(0, std::memory_order_relaxed);
+        stats.assign(readers, ReaderStats{});
+
+        std::atomic<bool> done{false};
+        std::atomic<int> ready{0};
+        std::vector<std::thread> threads;
+        for (int r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                ReaderStats& st = stats[r];
+                if (stamp) st.lag_ticks.reserve(NUM_CMDS);
+                uint64_t last = 0;
+                ready.fetch_add(1);
+                TopOfBookView view;
+                while (!done.load(std::memory_order_relaxed)) {
+                    if (!top.try_read(view)) { ++st.retries; cpu_relax(); continue; }
+                    ++st.reads;
+                    if (view.version == last) continue;
+                    const uint64_t seen = tsc_now();
+                    ++st.new_versions;
+                    st.skipped += view.version - last - 1;
+                    last = view.version;
+                    if (!stamp) continue;
+                    uint64_t published;
+                    while ((published = stamps[view.version].load(std::memory_order_acquire)) == 0 &&
+                           !done.load(std::memory_order_relaxed)) {
+                        cpu_relax();
+                    }
+                    if (published == 0) break;
+                    st.lag_ticks.push_back(seen > published ? seen - published : 0);
+                }
+            });
+        }
+        while (ready.load() < readers) std::this_thread::yield();
+
+        uint64_t stamped = top.version(); // the publish set_top_of_book did
+        if (stamp) stamps[stamped].store(tsc_now(), std::memory_order_release);
+        ResultSink sink(std::max<size_t>(batch, 1), std::max<size_t>(batch, 1) * 64);
+        auto start = std::chrono::high_resolution_clock::now();
+        if (batch > 0) {
+            for (size_t i = 0; i < commands.size(); i += batch) {
+                book.process_commands(std::span<const Command>(commands).subspan(i, std::min(batch, commands.size() - i)), sink);
+            }
+        }
+        for (const Command& cmd : batch > 0 ? std::span<const Command>() : std::span<const Command>(commands)) {
+            if (cmd.type == CommandType::New) book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+            else                              book.cancel_order(cmd.order_id);
+            if (stamp && top.version() != stamped) {
+                stamped = top.version();
+                stamps[stamped].store(tsc_now(), std::memory_order_release);
+            }
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        done = true;
+        for (auto& t : threads) t.join();
+        return std::make_pair(NUM_CMDS / elapsed, top.version());
+    };
+
+    std::cout << "\n=== Top-of-book seqlock (" << NUM_CMDS << " cmds, " << cores << " cores) ===\n";
+    if (cores < 2) std::cout << "  (one core - readers time-share with the matcher, so the reader rows are mostly the scheduler)\n";
+    std::vector<ReaderStats> stats;
+    const double base = run(false, TOP_LEVELS, 0, false, stats).first;
+    auto label = [](const std::string& text) { std::cout << "  " << std::left << std::setw(26) << text + ":" << std::right; };
+    label("nothing attached");
+    std::cout << static_cast<long long>(base) << " cmds/sec\n";
+    for (size_t levels : {size_t(1), TOP_LEVELS}) {
+        auto [rate, versions] = run(true, levels, 0, false, stats);
+        label(std::to_string(levels) + (levels == 1 ? " level" : " levels") + ", no readers");
+        std::cout << static_cast<long long>(rate)
+                  << " cmds/sec (" << std::showpos << std::fixed << std::setprecision(1) << (rate / base - 1) * 100 << "%"
+                  << std::noshowpos << "), published on " << versions * 100.0 / NUM_CMDS << "% of calls\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+    {
+        const double batch_base = run(false, TOP_LEVELS, 0, false, stats, 64).first;
+        auto [rate, versions] = run(true, TOP_LEVELS, 0, false, stats, 64);
+        label("batches of 64, nothing");
+        std::cout << static_cast<long long>(batch_base) << " cmds/sec\n";
+        label("batches of 64, " + std::to_string(TOP_LEVELS) + " levels");
+        std::cout << static_cast<long long>(rate) << " cmds/sec ("
+                  << std::showpos << std::fixed << std::setprecision(1) << (rate / batch_base - 1) * 100 << "%" << std::noshowpos
+                  << "), one publish per batch\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+    for (int readers : {1, 2, 4}) {
+        auto [rate, versions] = run(true, TOP_LEVELS, readers, false, stats);
+        uint64_t reads = 0, retries = 0;
+        for (const auto& st : stats) { reads += st.reads; retries += st.retries; }
+        label(std::to_string(TOP_LEVELS) + " levels, " + std::to_string(readers) + (readers == 1 ? " reader" : " readers"));
+        std::cout << static_cast<long long>(rate) << " cmds/sec (" << std::showpos << std::fixed << std::setprecision(1)
+                  << (rate / base - 1) * 100 << "%" << std::noshowpos << "), " << reads << " reads, "
+                  << std::setprecision(2) << retries * 100.0 / std::max<uint64_t>(reads + retries, 1) << "% retried\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    // staleness, with the matcher stamping each publish. tsc ticks -> ns off the wall clock over the run
+    for (int readers : {1, 4}) {
+        const uint64_t tsc0 = tsc_now();
+        auto wall0 = std::chrono::steady_clock::now();
+        run(true, TOP_LEVELS, readers, true, stats);
+        const double ticks_per_ns = (tsc_now() - tsc0) /
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall0).count();
+        std::vector<uint64_t> lag;
+        uint64_t seen = 0, skipped = 0;
+        for (const auto& st : stats) {
+            lag.insert(lag.end(), st.lag_ticks.begin(), st.lag_ticks.end());
+            seen += st.new_versions;
+            skipped += st.skipped;
+        }
+        if (lag.empty()) continue;
+        std::sort(lag.begin(), lag.end());
+        auto pct = [&](double p) { return lag[static_cast<size_t>(p * (lag.size() - 1))] / ticks_per_ns; };
+        label("staleness, " + std::to_string(readers) + (readers == 1 ? " reader" : " readers"));
+        std::cout << std::fixed << std::setprecision(0) << "publish -> read p50 " << pct(0.50) << " ns, p99 " << pct(0.99) << " ns, p99.9 " << pct(0.999)
+                  << " ns; " << std::setprecision(2) << skipped * 100.0 / std::max<uint64_t>(seen + skipped, 1)
+                  << "% of versions never seen\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+// decode + match straight out of a captured binary message file instead of an in-memory Order vector
+// the capture is written once up front (same order flow as run_performance_benchmark, 20% cancels),
+// then mapped and pushed through ProtocolDecoder in one pass - so the timed part includes reading
+// the wire format and encoding every exec / trade report, which is what a real gateway would pay
+void run_decode_benchmark() {
+    const int NUM_OPS = 2'500'000;
+
+    std::mt19937 gen(42);
+    auto mid_path = generate_mid_path(NUM_OPS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+
+    std::vector<uint8_t> capture;
+    capture.reserve(commands.size() * sizeof(NewOrderMsg));
+    uint64_t client_order_id = 0;
+    for (const Command& cmd : commands) {
+        if (cmd.type == CommandType::New) {
+            append_new_order(capture, Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity), ++client_order_id);
+        } else {
+            append_cancel(capture, cmd.order_id);
+        }
+    }
+    auto path = std::filesystem::temp_directory_path() / "orderbook_capture.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(capture.data()), static_cast<std::streamsize>(capture.size()));
+    }
+
+    double elapsed = 0.0;
+    DecodeStats stats;
+    {
+        MappedFile file(path.string());
+        OrderBook book;
+        ReportBuffer reports(1 << 20);
+        ProtocolDecoder decoder(book, reports);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t pos = 0;
+        while (pos < file.size()) {
+            pos += decoder.decode(file.data() + pos, file.size() - pos);
+            reports.clear(); // this is where a gateway would send the reports on
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        elapsed = std::chrono::duration<double>(end - start).count();
+        stats = decoder.stats();
+    }
+    std::filesystem::remove(path);
+
+    std::cout << "\n=== Decode + match from capture file (" << capture.size() / (1024 * 1024) << " MB) ===\n";
+    std::cout << "  Messages:    " << stats.messages << " (" << stats.new_orders << " new, "
+              << stats.cancels << " cancel)\n";
+    std::cout << "  Trades:      " << stats.trades << "\n";
+    std::cout << "  Time:        " << elapsed << " s\n";
+    std::cout << "  Throughput:  " << static_cast<long long>(stats.messages / elapsed) << " msgs/sec\n";
+}
+
+// what publishing incremental market data costs on top of matching: the same add + cancel flow as
+// run_performance_benchmark with no feed, a plain feed, and a conflating feed. the feed is drained
+// every 4096 ops, roughly what a publisher thread batching onto the wire would do
+void run_market_data_benchmark() {
+    const int NUM_OPS = 2'500'000;
+
+    std::mt19937 gen(42);
+    auto mid_path = generate_mid_path(NUM_OPS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+
+    std::cout << "\n=== Market data publishing cost (" << NUM_OPS << " ops) ===\n";
+    for (int mode = 0; mode < 3; ++mode) {
+        OrderBook book;
+        MarketDataFeed feed(1 << 20, mode == 2);
+        if (mode > 0) book.set_market_data(&feed);
+
+        uint64_t events = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < NUM_OPS; ++i) {
+            const Command& cmd = commands[i];
+            if (cmd.type == CommandType::New) {
+                book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+            } else {
+                book.cancel_order(cmd.order_id);
+            }
+            if ((i & 4095) == 0) {
+                events += feed.events().size();
+                feed.clear();
+            }
+        }
+        events += feed.events().size();
+        auto end = std::chrono::high_resolution_clock::now();
+        double elapsed = std::chrono::duration<double>(end - start).count();
+
+        const char* label = mode == 0 ? "no feed:      " : mode == 1 ? "feed:         " : "feed+conflate:";
+        std::cout << "  " << label << " " << static_cast<long long>(NUM_OPS / elapsed) << " ops/sec, "
+                  << events << " events\n";
+    }
+}
+
+// what the write-ahead journal costs the matching thread, and how fast a restart can rebuild the
+// book from it. same add + cancel flow as run_performance_benchmark, once without a journal and
+// once with one, then the journal is replayed into a fresh book - that replay rate is roughly how
+// long recovery takes per million inputs. the replayed book has to come out identical
+void run_journal_benchmark() {
+    const int NUM_OPS = 2'500'000;
+
+    std::mt19937 gen(42);
+    auto mid_path = generate_mid_path(NUM_OPS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+
+    auto path = std::filesystem::temp_directory_path() / "orderbook_journal.bin";
+    std::filesystem::remove(path);
+
+    // top of book + the last trades, to check the replayed book against the live one
+    auto book_state = [](const OrderBook& book) {
+        DepthLevel bids[16], asks[16];
+        size_t nb = book.get_depth(OrderSide::Buy, bids), na = book.get_depth(OrderSide::Sell, asks);
+        uint64_t h = book.get_trade_history().size();
+        for (size_t i = 0; i < nb; ++i) h = h * 31 + static_cast<uint64_t>(bids[i].price) * bids[i].quantity;
+        for (size_t i = 0; i < na; ++i) h = h * 31 + static_cast<uint64_t>(asks[i].price) * asks[i].quantity;
+        return h;
+    };
+
+    std::cout << "\n=== Write-ahead journal (" << NUM_OPS << " ops) ===\n";
+    uint64_t live_state = 0;
+    uint64_t records = 0;
+    for (int mode = 0; mode < 2; ++mode) {
+        OrderBook book;
+        std::unique_ptr<Journal> journal;
+        if (mode == 1) {
+            journal = std::make_unique<Journal>(JournalConfig{path.string()});
+            book.set_journal(journal.get());
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const Command& cmd : commands) {
+            if (cmd.type == CommandType::New) {
+                book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+            } else {
+                book.cancel_order(cmd.order_id);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double elapsed = std::chrono::duration<double>(end - start).count();
+
+        std::cout << "  " << (mode == 0 ? "no journal:" : "journal:   ") << "  "
+                  << static_cast<long long>(NUM_OPS / elapsed) << " ops/sec\n";
+        if (mode == 1) {
+            journal->sync();
+            records = journal->count();
+            live_state = book_state(book);
+        }
+    }
+
+    OrderBook replayed;
+    auto start = std::chrono::high_resolution_clock::now();
+    ReplayStats stats = replay_journal(path.string(), replayed);
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    std::filesystem::remove(path);
+
+    std::cout << "  Journal records: " << records << " (" << records * sizeof(JournalRecord) / (1024 * 1024) << " MB)\n";
+    std::cout << "  Replay:      " << stats.records << " records in " << elapsed << " s = "
+              << stats.records / elapsed / 1e6 << " M msgs/sec\n";
+    std::cout << "  Replayed book " << (book_state(replayed) == live_state && stats.id_mismatches == 0
+                                        ? "matches" : "DOES NOT MATCH") << " the live one\n";
+}
+
+// market-maker amend flow: 2000 resting quotes (1000 a side) that get amended over and over - mostly
+// size trims at the same price, the rest re-quotes to a new price and size. run once as
+// modify_order and once the old way, as cancel_order + process_order with a fresh ID each time
+void run_modify_benchmark() {
+    const int NUM_QUOTES = 2000;
+    const int NUM_AMENDS = 5'000'000;
+
+    struct Amend { uint32_t slot; int32_t price; uint64_t quantity; };
+    struct Quote { OrderSide side; int32_t price; uint64_t quantity; };
+
+    // bids $99.50-$99.99, asks $100.01-$100.50 - nothing crosses, so every amend leaves the quote resting
+    std::mt19937 gen(13);
+    std::uniform_int_distribution<int32_t>  offset_dist(1, 50);
+    std::uniform_int_distribution<uint64_t> size_dist(50, 100);
+    std::uniform_int_distribution<uint64_t> trim_dist(1, 5);
+    std::uniform_int_distribution<uint32_t> slot_dist(0, NUM_QUOTES - 1);
+    std::uniform_real_distribution<double>  coin(0.0, 1.0);
+
+    std::vector<Quote> quotes(NUM_QUOTES);
+    for (int i = 0; i < NUM_QUOTES; ++i) {
+        OrderSide side = i < NUM_QUOTES / 2 ? OrderSide::Buy : OrderSide::Sell;
+        int32_t price = side == OrderSide::Buy ? 10000 - offset_dist(gen) : 10000 + offset_dist(gen);
+        quotes[i] = {side, price, size_dist(gen)};
+    }
+    std::vector<Amend> amends;
+    amends.reserve(NUM_AMENDS);
+    size_t trims = 0;
+    {
+        std::vector<Quote> q = quotes;
+        for (int i = 0; i < NUM_AMENDS; ++i) {
+            uint32_t s = slot_dist(gen);
+            if (q[s].quantity > 10 && coin(gen) < 0.7) {
+                q[s].quantity -= trim_dist(gen);
+                ++trims;
+            } else {
+                q[s].price = q[s].side == OrderSide::Buy ? 10000 - offset_dist(gen) : 10000 + offset_dist(gen);
+                q[s].quantity = size_dist(gen);
+            }
+            amends.push_back({s, q[s].price, q[s].quantity});
+        }
+    }
+
+    std::cout << "\n=== Order amends (" << NUM_AMENDS << " amends on " << NUM_QUOTES << " quotes, "
+              << trims * 100 / NUM_AMENDS << "% same-price trims) ===\n";
+    double elapsed[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        OrderBook book;
+        std::vector<uint64_t> ids(NUM_QUOTES);
+        for (int i = 0; i < NUM_QUOTES; ++i) {
+            ids[i] = book.process_order(Order(quotes[i].side, OrderType::Limit, quotes[i].price, quotes[i].quantity)).new_order_id;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        if (mode == 0) {
+            for (const Amend& a : amends) {
+                book.cancel_order(ids[a.slot]);
+                ids[a.slot] = book.process_order(Order(quotes[a.slot].side, OrderType::Limit, a.price, a.quantity)).new_order_id;
+            }
+        } else {
+            for (const Amend& a : amends) {
+                book.modify_order(ids[a.slot], a.price, a.quantity);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        elapsed[mode] = std::chrono::duration<double>(end - start).count();
+    }
+
+    std::cout << "  cancel + new:  " << elapsed[0] * 1e9 / NUM_AMENDS << " ns/amend ("
+              << static_cast<long long>(NUM_AMENDS / elapsed[0]) << " amends/sec)\n";
+    std::cout << "  modify_order:  " << elapsed[1] * 1e9 / NUM_AMENDS << " ns/amend ("
+              << static_cast<long long>(NUM_AMENDS / elapsed[1]) << " amends/sec)\n";
+    std::cout << "  Speedup:       " << elapsed[0] / elapsed[1] << "x\n";
+}
+
+// stop orders (StopBook.h) on the benchmark flow: once on its own, then with 100k and 1M stops
+// waiting well outside where the flow ever trades. none of them fire, so any difference is the
+// cost of checking for triggers. then a cascade - a ladder of buy stops one tick apart over a
+// ladder of asks, where each stop's fill sets off the next one
+void run_stop_benchmark() {
+    const int NUM_OPS = 2'000'000;
+
+    std::mt19937 gen(42);
+    auto mid_path = generate_mid_path(NUM_OPS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+
+    std::cout << "\n=== Stop orders (" << NUM_OPS << " ops of the benchmark flow) ===\n";
+    double base_ns = 0;
+    for (int num_stops : {0, 100'000, 1'000'000}) {
+        // the mid path stays inside $90-$110 - buy stops at $130-$150, sell stops at $50-$70 never fire
+        OrderBook book;
+        std::uniform_int_distribution<int32_t> away(3000, 5000);
+        for (int i = 0; i < num_stops; ++i) {
+            const bool buy = i & 1;
+            const int32_t trigger = buy ? 10000 + away(gen) : 10000 - away(gen);
+            book.place_stop(Order(buy ? OrderSide::Buy : OrderSide::Sell, OrderType::Market, 0, 10), trigger);
+        }
+        const uint64_t id_base = static_cast<uint64_t>(num_stops); // the stops used up the first IDs
+
+        uint64_t trades = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const Command& cmd : commands) {
+            if (cmd.type == CommandType::New) {
+                trades += book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity)).trades.size();
+            } else {
+                book.cancel_order(cmd.order_id + id_base);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count() / NUM_OPS;
+        if (num_stops == 0) base_ns = ns;
+
+        std::cout << "  " << std::setw(9) << num_stops << " dormant stops: " << std::fixed << std::setprecision(1)
+                  << ns << " ns/op (" << std::showpos << (ns / base_ns - 1.0) * 100.0 << std::noshowpos
+                  << "%), " << trades << " trades, " << book.pending_stops() << " still pending\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    const int CASCADE = 10'000;
+    OrderBookConfig config;
+    config.ladder_ticks = 2 * CASCADE;
+    OrderBook book(config);
+    for (int i = 1; i <= CASCADE; ++i) {
+        book.process_order(Order(OrderSide::Sell, OrderType::Limit, 10000 + i, 10));
+        book.place_stop(Order(OrderSide::Buy, OrderType::Market, 0, 10), 10000 + i);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    auto result = book.process_order(Order(OrderSide::Buy, OrderType::Market, 0, 10)); // prints at 10001
+    auto end = std::chrono::high_resolution_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  cascade: 1 order set off " << result.stops_triggered << " stops, " << result.trades.size()
+              << " trades, " << std::fixed << std::setprecision(1) << ns / result.stops_triggered << " ns per stop fired\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// what an iceberg's refill costs. the same 1M slices of 10 get taken three ways, one market buy of
+// 10 per slice:
+//   native     - one iceberg of 10M showing 10. each buy fills the slice, the book refills it in
+//                place (pop_front + push_back on the same level)
+//   plain      - 1M separate resting orders of 10. each buy fills one and it goes back to the pool
+//                and out of the lookup map - the floor, a refill can't beat a plain fill
+//   emulated   - what a client does without native icebergs: a plain order of 10, and every time
+//                it fills they send the next slice as a new order. two messages per slice, plus a
+//                new ID / pool slot / lookup entry each time
+void run_iceberg_benchmark() {
+    const int SLICES = 1'000'000;
+    const Quantity SLICE = 10;
+    const Order take(OrderSide::Buy, OrderType::Market, 0, SLICE);
+    std::cout << "\n=== Iceberg refill (" << SLICES << " slices of " << SLICE << ") ===\n";
+
+    auto report = [&](const char* label, double ns, size_t trades) {
+        std::cout << "  " << std::left << std::setw(10) << label << std::right << std::fixed << std::setprecision(1)
+                  << ns / SLICES << " ns per slice, " << trades << " trades\n";
+        std::cout.unsetf(std::ios::fixed);
+    };
+    auto since = [](auto start) {
+        return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    {
+        OrderBook book;
+        book.process_iceberg(Order(OrderSide::Sell, OrderType::Limit, 10100, SLICE * SLICES), SLICE);
+        size_t trades = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < SLICES; ++i) trades += book.process_order(take).trades.size();
+        report("native", since(start), trades);
+    }
+    {
+        OrderBook book;
+        for (int i = 0; i < SLICES; ++i) book.process_order(Order(OrderSide::Sell, OrderType::Limit, 10100, SLICE));
+        size_t trades = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < SLICES; ++i) trades += book.process_order(take).trades.size();
+        report("plain", since(start), trades);
+    }
+    {
+        OrderBook book;
+        const Order slice(OrderSide::Sell, OrderType::Limit, 10100, SLICE);
+        book.process_order(slice);
+        size_t trades = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < SLICES; ++i) {
+            trades += book.process_order(take).trades.size();
+            book.process_order(slice); // the client's re-send
+        }
+        report("emulated", since(start), trades);
+    }
+}
+
+// opening auction: 100k limit orders collected in the call phase (bids and asks both spread over
+// ~$10 either side of $100, so the book ends up crossed over most of that), then one uncross.
+// times the equilibrium search on its own (indicative_price), the full uncross, and the prefix
+// sum the search is built on, SIMD against the plain loop
+void run_auction_benchmark() {
+    const int NUM_ORDERS = 100'000;
+    std::mt19937 gen(11);
+    std::normal_distribution<double> px(0.0, 300.0);
+    std::uniform_int_distribution<int> qty(1, 100);
+    auto since = [](auto start) {
+        return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    OrderBook book;
+    book.start_auction();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_ORDERS; ++i) {
+        const bool buy = i & 1;
+        const int32_t price = 10000 + static_cast<int32_t>(std::lround(px(gen))) + (buy ? 100 : -100);
+        book.process_order(Order(buy ? OrderSide::Buy : OrderSide::Sell, OrderType::Limit, price, qty(gen)));
+    }
+    const double entry_ns = since(start) / NUM_ORDERS;
+
+    const int32_t crossed = book.get_best_bid() - book.get_best_ask();
+    const int SOLVES = 1000;
+    AuctionResult indicative;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < SOLVES; ++i) indicative = book.indicative_price(10000);
+    const double solve_ns = since(start) / SOLVES;
+
+    start = std::chrono::high_resolution_clock::now();
+    AuctionResult result = book.uncross(10000);
+    const double uncross_ns = since(start);
+
+    std::cout << "\n=== Call auction (" << NUM_ORDERS << " orders, crossed over "
+              << crossed << " ticks) ===\n" << std::fixed << std::setprecision(1);
+    std::cout << "  order entry in the call:   " << entry_ns << " ns/order\n";
+    std::cout << "  indicative_price:          " << solve_ns / 1000.0 << " us (price " << indicative.price
+              << ", volume " << indicative.volume << ", imbalance " << indicative.imbalance << ")\n";
+    std::cout << "  uncross:                   " << uncross_ns / 1000.0 << " us for " << result.trades.size()
+              << " trades (" << (uncross_ns - solve_ns) / std::max<size_t>(result.trades.size(), 1) << " ns per trade after the search)\n";
+
+    // the search's prefix sums on their own - one tick-wide array per side
+    for (size_t n : {size_t(2048), size_t(1) << 20}) {
+        std::vector<int64_t> data(n);
+        for (auto& v : data) v = qty(gen);
+        std::vector<int64_t> work = data;
+        const int reps = static_cast<int>(std::max<size_t>(1, (size_t(1) << 26) / n));
+        // each rep starts from a fresh copy (summing a sum would overflow), timed on its own and taken off
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < reps; ++r) { work = data; asm volatile("" : : "r"(work.data()) : "memory"); }
+        const double copy = since(start) / reps;
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < reps; ++r) { work = data; prefix_sum(work.data(), n); }
+        const double simd = since(start) / reps - copy;
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < reps; ++r) { work = data; prefix_sum_scalar(work.data(), n); }
+        const double scalar = since(start) / reps - copy;
+        std::cout << "  prefix sum, " << std::setw(7) << n << " ticks: " << simd / n << " ns/tick SIMD, "
+                  << scalar / n << " ns/tick scalar (" << scalar / simd << "x)\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// a thin, wide book (one small order on each of thousands of ticks per side) hit with big FOK orders
+// that can't be filled - without the prefix index each one adds up hundreds of levels before it gets
+// killed, with it it's one O(log N) query. also times the sweep_price risk query on its own, and the
+// cost the index adds to the normal add + cancel flow (every fill becomes a tree update)
+void run_wide_book_fok_benchmark() {
+    const int32_t WIDTH = 5000;    // levels per side
+    const uint64_t LEVEL_QTY = 10;
+    const int NUM_FOK = 200'000;
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int32_t> reach_dist(100, WIDTH); // how many levels deep the limit is
+
+    // every FOK asks for one more than sits inside its limit, so it walks all of it and gets killed
+    std::vector<Order> foks;
+    foks.reserve(NUM_FOK);
+    for (int i = 0; i < NUM_FOK; ++i) {
+        int32_t reach = reach_dist(gen);
+        if (i % 2 == 0) foks.emplace_back(OrderSide::Buy,  OrderType::FOK, 10000 + reach, reach * LEVEL_QTY + 1);
+        else            foks.emplace_back(OrderSide::Sell, OrderType::FOK, 10000 - reach, reach * LEVEL_QTY + 1);
+    }
+
+    std::cout << "\n=== Wide book FOK / sweep queries (" << WIDTH << " levels per side) ===\n";
+    for (bool indexed : {false, true}) {
+        OrderBookConfig config;
+        config.prefix_index = indexed;
+        config.ladder_ticks = 2 * WIDTH + 2;
+        OrderBook book(config);
+        for (int32_t i = 1; i <= WIDTH; ++i) {
+            book.process_order({OrderSide::Sell, OrderType::Limit, 10000 + i, LEVEL_QTY});
+            book.process_order({OrderSide::Buy,  OrderType::Limit, 10000 - i, LEVEL_QTY});
+        }
+
+        uint64_t killed = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const Order& o : foks) {
+            if (book.process_order(o).status == OrderStatus::Killed) ++killed;
+        }
+        auto mid = std::chrono::high_resolution_clock::now();
+        int64_t checksum = 0;
+        for (const Order& o : foks) checksum += book.sweep_price(o.side, o.quantity - 1);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double fok_ns   = std::chrono::duration<double, std::nano>(mid - start).count() / NUM_FOK;
+        double sweep_ns = std::chrono::duration<double, std::nano>(end - mid).count() / NUM_FOK;
+        std::cout << "  " << (indexed ? "prefix index:" : "level walk:  ")
+                  << " FOK kill " << static_cast<long long>(fok_ns) << " ns/order (" << killed << " killed)"
+                  << ", sweep_price " << static_cast<long long>(sweep_ns) << " ns/query"
+                  << " (checksum " << checksum << ")\n";
+    }
+
+    // the other side of the trade-off - what keeping the tree up to date costs on the normal flow
+    const int NUM_OPS = 1'000'000;
+    auto mid_path = generate_mid_path(NUM_OPS, gen);
+    auto orders   = generate_orders(mid_path, gen);
+    std::vector<uint64_t> ids_issued;
+    auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+    for (bool indexed : {false, true}) {
+        OrderBookConfig config;
+        config.prefix_index = indexed;
+        OrderBook book(config);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const Command& cmd : commands) {
+            if (cmd.type == CommandType::New) {
+                book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+            } else {
+                book.cancel_order(cmd.order_id);
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "  main flow, " << (indexed ? "prefix index: " : "no index:     ")
+                  << static_cast<long long>(NUM_OPS / elapsed) << " ops/sec\n";
+    }
+}
 
 static const char* status_str(OrderStatus s) {
     switch (s) {
@@ -163,6 +1154,10 @@ static const char* status_str(OrderStatus s) {
         case OrderStatus::Filled:      return "Filled";
         case OrderStatus::PartialFill: return "PartialFill (IoC)";
         case OrderStatus::Killed:      return "Killed (FOK)";
+        case OrderStatus::Cancelled:   return "Cancelled";
+        case OrderStatus::Rejected:    return "Rejected";
+        case OrderStatus::Pending:     return "Pending (stop)";
+        case OrderStatus::Expired:     return "Expired";
     }
     return "Unknown";
 }
@@ -218,6 +1213,512 @@ void general_test(OrderBook& order_book) {
     print_result("FOK Buy @$100.00 qty5  vs ask@$100 qty5  (expect Filled)", fok2);
 
     std::cout << "\nFinal Order Book State:\n" << order_book << "\n";
+
+    std::cout << "=== Stop tests (own book) ===\n";
+    OrderBook stop_book;
+    stop_book.process_order({OrderSide::Sell, OrderType::Limit, 10100, 5});
+    stop_book.process_order({OrderSide::Sell, OrderType::Limit, 10200, 5});
+    stop_book.process_order({OrderSide::Sell, OrderType::Limit, 10300, 5});
+
+    auto s1 = stop_book.place_stop({OrderSide::Buy, OrderType::Market, 0, 5}, 10100);
+    auto s2 = stop_book.place_stop({OrderSide::Buy, OrderType::Limit, 10300, 5}, 10200);
+    print_result("Buy stop (market) trigger $101.00 qty5 (expect Pending)", s1);
+    print_result("Buy stop-limit @$103.00 trigger $102.00 qty5 (expect Pending)", s2);
+
+    // trades at $101 -> fires the first stop, which trades at $102 -> fires the stop-limit, which takes $103
+    auto s3 = stop_book.process_order({OrderSide::Buy, OrderType::Limit, 10100, 5});
+    print_result("Limit Buy @$101.00 qty5 (expect 3 trades - 2 stops fired in a cascade)", s3);
+    std::cout << "  stops triggered: " << s3.stops_triggered << ", still pending: " << stop_book.pending_stops() << "\n\n";
+
+    std::cout << "=== Iceberg tests (own book) ===\n";
+    OrderBook ice_book;
+    auto i1 = ice_book.process_iceberg({OrderSide::Sell, OrderType::Limit, 10100, 50}, 10);
+    print_result("Iceberg Sell @$101.00 qty50 showing 10 (expect Resting)", i1);
+    ice_book.process_order({OrderSide::Sell, OrderType::Limit, 10100, 5});
+
+    // the slice fills and goes to the back, behind the plain order - which fills next
+    auto i2 = ice_book.process_order({OrderSide::Buy, OrderType::Market, 0, 25});
+    print_result("Market Buy qty25 (expect 3 trades - slice, plain order, next slice)", i2);
+    std::cout << ice_book << "\n";
+
+    // only 10 is showing, but the reserve trades at the same price - the dry run has to count it,
+    // with and without the prefix index
+    for (bool indexed : {false, true}) {
+        OrderBookConfig config;
+        config.prefix_index = indexed;
+        OrderBook fok_book(config);
+        auto f0 = fok_book.process_iceberg({OrderSide::Sell, OrderType::Limit, 10100, 50}, 10);
+        auto f1 = fok_book.process_order({OrderSide::Buy, OrderType::FOK, 10100, 30});
+        print_result(indexed ? "FOK Buy @$101.00 qty30 vs iceberg showing 10 of 50, indexed (expect Filled, 3 trades)"
+                             : "FOK Buy @$101.00 qty30 vs iceberg showing 10 of 50 (expect Filled, 3 trades)", f1);
+        std::cout << "  available to a buy @$101.00: " << fok_book.available_quantity(OrderSide::Buy, 10100)
+                  << ", qty 20 sweeps to " << fmt_price(fok_book.sweep_price(OrderSide::Buy, 20)) << " (expect 20, $101.00)\n";
+        auto f2 = fok_book.process_order({OrderSide::Buy, OrderType::FOK, 10100, 21});
+        print_result("FOK Buy @$101.00 qty21 (expect Killed)", f2);
+        fok_book.cancel_order(f0.new_order_id);
+        std::cout << "  after cancelling the iceberg: " << fok_book.available_quantity(OrderSide::Buy, 10100) << " (expect 0)\n";
+    }
+    std::cout << "\n";
+
+    std::cout << "=== Auction tests (own book) ===\n";
+    OrderBook auction_book;
+    auction_book.start_auction();
+    auction_book.process_order({OrderSide::Buy, OrderType::Limit, 10200, 10});
+    auction_book.process_order({OrderSide::Buy, OrderType::Limit, 10100, 10});
+    auction_book.process_order({OrderSide::Sell, OrderType::Limit, 10000, 5});
+    auto a1 = auction_book.process_order({OrderSide::Sell, OrderType::Limit, 10100, 10});
+    print_result("Sell @$101.00 qty10 into bids @$102/$101 during the call (expect Resting, no trades)", a1);
+    auto a2 = auction_book.process_order({OrderSide::Sell, OrderType::Market, 0, 5});
+    print_result("Market Sell qty5 during the call (expect Rejected)", a2);
+
+    auto ind = auction_book.indicative_price();
+    std::cout << "Indicative price=" << fmt_price(ind.price) << " volume=" << ind.volume << " imbalance=" << ind.imbalance
+              << " (expect $101.00, 15, 5)\n";
+    auto a3 = auction_book.uncross();
+    std::cout << "Uncross price=" << fmt_price(a3.price) << ", trades=" << a3.trades.size() << "\n";
+    for (const auto& t : a3.trades) {
+        std::cout << "    Trade: buyer=" << t.buyer_order_id
+                  << " seller=" << t.seller_order_id
+                  << " price=" << fmt_price(t.price)
+                  << " qty=" << t.quantity << "\n";
+    }
+    std::cout << auction_book << "\n";
+
+    // an iceberg's reserve is in the curves, so its refills trade in the same round at the same
+    // price. counting only the displayed 10 would pick $101.00, and the refill left behind would
+    // cross again at $100.00
+    OrderBook ice_auction;
+    ice_auction.start_auction();
+    ice_auction.process_iceberg({OrderSide::Sell, OrderType::Limit, 10000, 30}, 10);
+    ice_auction.process_order({OrderSide::Sell, OrderType::Limit, 10100, 10});
+    ice_auction.process_order({OrderSide::Buy, OrderType::Limit, 10200, 25});
+    auto a4 = ice_auction.uncross();
+    bool one_price = true;
+    for (const auto& t : a4.trades) one_price = one_price && t.price == a4.price;
+    std::cout << "Uncross vs iceberg showing 10 of 30: price=" << fmt_price(a4.price) << " volume=" << a4.volume
+              << ", trades=" << a4.trades.size() << ", all at that price: " << (one_price ? "yes" : "no")
+              << " (expect $100.00, 25, 3, yes)\n";
+    std::cout << ice_auction << "\n";
+
+    std::cout << "=== Price band tests (own book) ===\n";
+    OrderBook band_book;
+    // a bid rests, so a second bid can only rest if the band stretches from $100.00 to wherever it is
+    auto b2 = band_book.process_order({OrderSide::Buy, OrderType::Limit, 10000, 5});
+    band_book.process_order({OrderSide::Sell, OrderType::Limit, 10100, 5});
+    auto b1 = band_book.process_order({OrderSide::Buy, OrderType::Limit, 10100 + (1 << 25), 10});
+    print_result("Limit Buy 2^25 ticks above the bids, crossing the ask (expect Rejected, no trades)", b1);
+    auto b3 = band_book.modify_order(b2.new_order_id, 10000 - (1 << 25), 5);
+    print_result("Modify that bid 2^25 ticks down (expect Rejected)", b3);
+    auto b4 = band_book.place_stop({OrderSide::Buy, OrderType::Limit, 10000 + (1 << 25), 5}, 10100);
+    print_result("Buy stop-limit priced 2^25 ticks away (expect Rejected)", b4);
+    std::cout << band_book << "\n";
+
+    std::cout << "=== Malformed frames (own book) ===\n";
+    OrderBook wire_book;
+    ReportBuffer wire_reports(4096);
+    ProtocolDecoder decoder(wire_book, wire_reports, 256);
+    std::vector<uint8_t> frames;
+    append_new_order(frames, {OrderSide::Buy, OrderType::Limit, 10000, 5}, 1);
+    append_new_order(frames, {static_cast<OrderSide>(7), OrderType::Limit, 10000, 5}, 2);
+    append_new_order(frames, {OrderSide::Sell, static_cast<OrderType>(9), 10000, 5}, 3);
+    append_new_order(frames, {OrderSide::Sell, OrderType::Limit, -10000, 5}, 4);
+    append_replace(frames, 1, static_cast<OrderSide>(2), 10001, 5);
+    decoder.decode(frames.data(), frames.size());
+    const auto* reports = reinterpret_cast<const ExecReportMsg*>(wire_reports.data());
+    for (size_t i = 0; i < decoder.stats().messages; ++i) {
+        std::cout << "frame " << i + 1 << ": " << static_cast<int>(reports[i].status) << "\n";
+    }
+    std::cout << "malformed: " << decoder.stats().malformed
+              << " (expect 4 - only frame 1 reaches the book: status 0 = Resting, 5 = Rejected)\n";
+    std::cout << wire_book << "\n";
+
+    std::cout << "=== Client order IDs echoed from the cold array (own book) ===\n";
+    OrderBook echo_book;
+    ReportBuffer echo_reports(4096);
+    ProtocolDecoder echo_decoder(echo_book, echo_reports, 256);
+    std::vector<uint8_t> echo_frames;
+    echo_frames.reserve(128);
+    append_new_order(echo_frames, {OrderSide::Buy, OrderType::Limit, 10000, 5}, 42);  // rests as id 1
+    append_new_order(echo_frames, {OrderSide::Sell, OrderType::Limit, 10100, 5}, 43); // rests as id 2
+    append_replace(echo_frames, 1, OrderSide::Buy, 9990, 5);
+    append_cancel(echo_frames, 2);
+    append_cancel(echo_frames, 2);
+    echo_decoder.decode(echo_frames.data(), echo_frames.size());
+    const auto* echoed = reinterpret_cast<const ExecReportMsg*>(echo_reports.data());
+    for (size_t i = 0; i < echo_decoder.stats().messages; ++i) {
+        std::cout << "report " << i + 1 << ": client_order_id " << echoed[i].client_order_id << "\n";
+    }
+    std::cout << "(expect 42, 43, 42, 43, then 0 - the second cancel finds nothing resting)\n\n";
+
+    std::cout << "=== Oversized quantities (own book) ===\n";
+    // Command::quantity is 64-bit, a resting Order's is 32 - 5e9 has to be refused, not rest as 705032704
+    OrderBook big_book;
+    auto resting = big_book.process_order({OrderSide::Sell, OrderType::Limit, 10100, 5});
+    std::vector<Command> big = {
+        Command::new_order(0, {OrderSide::Buy, OrderType::Limit, 10000, 1}),
+        Command::stop(0, {OrderSide::Buy, OrderType::Limit, 10200, 1}, 10150),
+        Command::iceberg(0, {OrderSide::Buy, OrderType::Iceberg, 10000, 1}, 100),
+        Command::modify(0, resting.new_order_id, 10100, 5'000'000'000ULL),
+    };
+    for (Command& c : big) c.quantity = 5'000'000'000ULL;
+    ResultSink big_results(big.size());
+    big_book.process_commands(big, big_results);
+    for (size_t i = 0; i < big_results.size(); ++i) {
+        std::cout << "command " << i + 1 << ": " << static_cast<int>(big_results[i].status) << "\n";
+    }
+    std::cout << "(expect all four 5 = Rejected, and only the 5 @ $101.00 in the book)\n";
+    std::cout << big_book << "\n";
+
+    std::cout << "=== Mass cancel by owner (own book) ===\n";
+    // owner 7's orders are linked through their cold entries - the one that fills comes off its
+    // list then, so the mass cancel only meets what's still there, stop included
+    OrderBook owned_book;
+    owned_book.process_order({OrderSide::Sell, OrderType::Limit, 10100, 5}, TimeInForce::GTC, 0, 7);
+    owned_book.process_order({OrderSide::Sell, OrderType::Limit, 10200, 5}, TimeInForce::GTC, 0, 7);
+    owned_book.process_order({OrderSide::Buy, OrderType::Limit, 10000, 5}, TimeInForce::GTC, 0, 7);
+    owned_book.process_order({OrderSide::Buy, OrderType::Limit, 9900, 5}, TimeInForce::GTC, 0, 8);
+    owned_book.place_stop({OrderSide::Buy, OrderType::Market, 0, 5}, 10300, 7);
+    owned_book.process_order({OrderSide::Buy, OrderType::Market, 0, 5}); // fills owner 7's 10100 ask
+    std::span<const uint64_t> sells = owned_book.mass_cancel(7, OrderSide::Sell);
+    std::cout << "mass_cancel(7, Sell): " << sells.size() << " cancelled (expect 1 - the 10200 ask)\n";
+    std::span<const uint64_t> rest = owned_book.mass_cancel(7);
+    std::cout << "mass_cancel(7): " << rest.size() << " cancelled (expect 2 - the 10000 bid and the stop)\n";
+    std::cout << "mass_cancel(7) again: " << owned_book.mass_cancel(7).size() << " cancelled (expect 0)\n";
+    std::cout << "(expect only owner 8's bid @ $99.00 left)\n";
+    std::cout << owned_book << "\n";
+}
+
+// warm restart: a book with 2M resting orders, restored once by replaying the journal that built it
+// and once from a snapshot. also times writing the snapshot in-line vs forking it off - for the
+// fork the number that matters is how long the matcher was stopped, not how long the child took
+void run_snapshot_benchmark() {
+    const int NUM_ORDERS = 2'000'000;
+    auto tmp = std::filesystem::temp_directory_path();
+    auto journal_path = tmp / "orderbook_snapshot_bench.jrnl";
+    auto snap_path    = tmp / "orderbook_snapshot_bench.snap";
+    std::filesystem::remove(journal_path);
+
+    // bids $90.00-$99.99, asks $100.01-$109.99 - nothing crosses, so every order rests
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int32_t>  offset_dist(1, 999);
+    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    OrderBook live;
+    auto seconds_since = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+    {
+        Journal journal(JournalConfig{journal_path.string()});
+        live.set_journal(&journal);
+        for (int i = 0; i < NUM_ORDERS; ++i) {
+            bool buy = (i & 1) == 0;
+            int32_t price = buy ? 10000 - offset_dist(gen) : 10000 + offset_dist(gen);
+            live.process_order(Order(buy ? OrderSide::Buy : OrderSide::Sell, OrderType::Limit, price, qty_dist(gen)));
+        }
+        live.set_journal(nullptr);
+    }
+
+    std::cout << "\n=== Snapshot / restore (" << NUM_ORDERS << " resting orders) ===\n";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    live.save_snapshot(snap_path.string());
+    std::cout << "  save_snapshot:          " << seconds_since(start) * 1e3 << " ms ("
+              << std::filesystem::file_size(snap_path) / (1024 * 1024) << " MB)\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    int pid = live.save_snapshot_async(snap_path.string());
+    double stall = seconds_since(start);
+    bool ok = OrderBook::wait_snapshot(pid);
+    std::cout << "  save_snapshot_async:    " << stall * 1e3 << " ms matcher stall, "
+              << seconds_since(start) * 1e3 << " ms until the child finished" << (ok ? "" : " (FAILED)") << "\n";
+
+    double replay_s = 0.0, load_s = 0.0;
+    bool same = true;
+    {
+        OrderBook book;
+        start = std::chrono::high_resolution_clock::now();
+        replay_journal(journal_path.string(), book);
+        replay_s = seconds_since(start);
+    }
+    {
+        OrderBook book;
+        start = std::chrono::high_resolution_clock::now();
+        book.load_snapshot(snap_path.string());
+        load_s = seconds_since(start);
+
+        DepthLevel a[64], b[64];
+        for (OrderSide side : {OrderSide::Buy, OrderSide::Sell}) {
+            size_t n = live.get_depth(side, a);
+            same = same && n == book.get_depth(side, b);
+            for (size_t i = 0; i < n && same; ++i)
+                same = a[i].price == b[i].price && a[i].count == b[i].count && a[i].quantity == b[i].quantity;
+        }
+    }
+    std::filesystem::remove(journal_path);
+    std::filesystem::remove(snap_path);
+
+    std::cout << "  restore by replay:      " << replay_s * 1e3 << " ms\n";
+    std::cout << "  restore from snapshot:  " << load_s * 1e3 << " ms" << (same ? "" : " (BOOK DIFFERS)") << "\n";
+}
+
+// research replays: a directory of per-symbol journals through ReplayRunner. first the plain
+// serial loop - a new default book for every journal, which is mostly building and tearing down
+// the book - then the runner, whose workers build one book each and reset it between journals,
+// at 1, 2, 4 ... workers up to the core count
+void run_replay_benchmark() {
+    const uint32_t NUM_SYMBOLS = 16;
+    auto dir = std::filesystem::temp_directory_path() / "orderbook_replay_bench";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // uneven days - 40k to 280k messages a symbol, so some workers run dry early and have to steal
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> length_dist(40'000, 280'000);
+    uint64_t total_records = 0;
+    for (uint32_t sym = 0; sym < NUM_SYMBOLS; ++sym) {
+        const int n = length_dist(gen);
+        auto mid_path = generate_mid_path(n, gen);
+        auto orders   = generate_orders(mid_path, gen);
+        std::vector<uint64_t> ids_issued;
+        auto commands = generate_commands(orders, 1, 0.20, ids_issued, gen);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "SYM%02u.jrnl", sym);
+        OrderBookConfig config;
+        config.initial_orders = ids_issued[0] + 1; // just recording - no need for the full-size pool
+        OrderBook book(config);
+        Journal journal(JournalConfig{(dir / name).string()});
+        book.set_journal(&journal);
+        for (const Command& cmd : commands) {
+            if (cmd.type == CommandType::New) {
+                book.process_order(Order(cmd.side, cmd.order_type, cmd.price, cmd.quantity));
+            } else {
+                book.cancel_order(cmd.order_id);
+            }
+        }
+        journal.sync();
+        total_records += journal.count();
+        book.set_journal(nullptr);
+    }
+
+    std::cout << "\n=== Parallel replay (" << NUM_SYMBOLS << " journals, " << total_records << " messages) ===\n";
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) paths.push_back(entry.path());
+    std::sort(paths.begin(), paths.end());
+    double build_s = 0.0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& path : paths) {
+        auto built = std::chrono::high_resolution_clock::now();
+        OrderBook book;
+        build_s += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - built).count();
+        replay_journal(path.string(), book);
+    }
+    double serial_s = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "  fresh book per journal:  " << static_cast<long long>(total_records / serial_s) << " msgs/sec  ("
+              << build_s / paths.size() * 1e3 << " ms to build each book, " << build_s / serial_s * 100 << "% of the run)\n";
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    double base_throughput = 0.0;
+    ReplayReport widest;
+    for (uint32_t threads = 1; threads <= std::min(cores, 16u); threads *= 2) {
+        ReplayRunnerConfig config;
+        config.threads = threads;
+        ReplayRunner runner(config);
+        ReplayReport report = runner.run_directory(dir.string());
+
+        double throughput = report.msgs_per_sec();
+        if (threads == 1) base_throughput = throughput;
+        std::cout << "  runner, " << std::setw(2) << threads << " worker(s):   " << static_cast<long long>(throughput)
+                  << " msgs/sec  (x" << std::setprecision(3) << throughput / base_throughput << std::setprecision(6)
+                  << " vs 1 worker, " << report.steals << " steals, " << report.totals.trades << " trades"
+                  << (report.failed ? ", SOME FAILED" : "") << ")\n";
+        widest = std::move(report);
+    }
+
+    std::cout << "  per journal, " << widest.threads << " worker(s):\n";
+    for (const ReplayJobResult& job : widest.jobs) {
+        std::cout << "    " << std::filesystem::path(job.path).filename().string() << "  worker " << job.worker
+                  << "  " << std::setw(6) << job.stats.records << " msgs  "
+                  << static_cast<long long>(job.msgs_per_sec()) << " msgs/sec\n";
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// a trading day of Day orders. 1M of them go in between the open and the close, nothing crosses
+// so they all rest, and the clock moves forward a second at a time the way a venue's timer would
+// drive it. at the close one advance_time takes every one of them out. compared with the same
+// orders as GTC (what an insert costs with the wheel vs without), and with the way it's done
+// without expiry - the client cancelling all 1M itself, one cancel_order each
+void run_expiry_benchmark() {
+    const int NUM_ORDERS = 1'000'000;
+    const uint64_t SECOND = 1'000'000'000;         // nanosecond clock
+    const uint64_t OPEN   = 34'200 * SECOND;       // 09:30
+    const uint64_t CLOSE  = 57'600 * SECOND;       // 16:00
+    const uint64_t STEPS  = (CLOSE - OPEN) / SECOND;
+
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int32_t> away(1, 1000);
+    std::uniform_int_distribution<Quantity> qty(1, 100);
+    std::vector<Order> orders;
+    orders.reserve(NUM_ORDERS);
+    for (int i = 0; i < NUM_ORDERS; ++i) {
+        const bool buy = gen() & 1;
+        orders.emplace_back(buy ? OrderSide::Buy : OrderSide::Sell, OrderType::Limit,
+                            buy ? 10000 - away(gen) : 10000 + away(gen), qty(gen));
+    }
+
+    std::cout << "\n=== Order expiry (" << NUM_ORDERS << " Day orders over a " << STEPS << " second session) ===\n";
+
+    // the same orders, the same clock steps - one book's are Day, the other's GTC
+    double insert_ns[2] = {};
+    double ticking_ns[2] = {};
+    std::unique_ptr<OrderBook> books[2];
+    for (int day = 0; day < 2; ++day) {
+        books[day] = std::make_unique<OrderBook>();
+        OrderBook& book = *books[day];
+        book.advance_time(OPEN);
+        book.set_day_close(CLOSE);
+        size_t next = 0;
+        double in = 0, tick = 0;
+        for (uint64_t step = 0; step < STEPS; ++step) {
+            const size_t until = static_cast<size_t>((step + 1) * NUM_ORDERS / STEPS);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (; next < until; ++next) {
+                if (day) book.process_order(orders[next], TimeInForce::Day);
+                else     book.process_order(orders[next]);
+            }
+            auto mid = std::chrono::high_resolution_clock::now();
+            book.advance_time(OPEN + (step + 1) * SECOND - 1); // the close itself is the last step's
+            auto end = std::chrono::high_resolution_clock::now();
+            in   += std::chrono::duration<double, std::nano>(mid - start).count();
+            tick += std::chrono::duration<double, std::nano>(end - mid).count();
+        }
+        insert_ns[day] = in / NUM_ORDERS;
+        ticking_ns[day] = tick;
+    }
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  insert, GTC:               " << insert_ns[0] << " ns/order\n";
+    std::cout << "  insert, Day:               " << insert_ns[1] << " ns/order (+" << insert_ns[1] - insert_ns[0]
+              << " ns for the wheel), " << books[1]->pending_expiries() << " waiting\n";
+    std::cout << "  clock through the session: " << ticking_ns[1] / 1e6 << " ms for " << STEPS
+              << " advances (" << ticking_ns[1] / STEPS << " ns each, cascades included)\n";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t expired = books[1]->advance_time(CLOSE).size();
+    auto end = std::chrono::high_resolution_clock::now();
+    const double close_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  close, one advance_time:   " << close_ns / 1e6 << " ms, " << expired << " expired ("
+              << close_ns / expired << " ns/order), book " << (books[1]->get_best_bid() == 0 && books[1]->get_best_ask() == 0 ? "empty" : "NOT EMPTY")
+              << " after\n";
+
+    // no expiry: the GTC book's orders cancelled one at a time. IDs are 1..N, in the order they went in
+    start = std::chrono::high_resolution_clock::now();
+    size_t cancelled = 0;
+    for (uint64_t id = 1; id <= static_cast<uint64_t>(NUM_ORDERS); ++id) cancelled += books[0]->cancel_order(id);
+    end = std::chrono::high_resolution_clock::now();
+    const double cancel_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  cancel storm instead:      " << cancel_ns / 1e6 << " ms, " << cancelled << " cancelled ("
+              << cancel_ns / cancelled << " ns/order, x" << std::setprecision(2) << cancel_ns / close_ns << " the close)\n";
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+// churned: each book first takes the same orders and cancels them all in random order, so its pool
+// hands slots out scattered, like a book some way into a session. a fresh pool hands them out in
+// ID order, so the cancel_order loop below reads memory front to back - the best case for it
+void run_mass_cancel_benchmark(bool churned) {
+    const int NUM_ORDERS = 1'000'000;
+    const uint32_t NUM_OWNERS = 10; // so one owner has 100k of them, spread through the whole book
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int32_t> away(1, 1000);
+    std::uniform_int_distribution<Quantity> qty(1, 100);
+    std::vector<Order> orders;
+    orders.reserve(NUM_ORDERS);
+    for (int i = 0; i < NUM_ORDERS; ++i) {
+        const bool buy = gen() & 1;
+        orders.emplace_back(buy ? OrderSide::Buy : OrderSide::Sell, OrderType::Limit,
+                            buy ? 10000 - away(gen) : 10000 + away(gen), qty(gen));
+    }
+
+    std::cout << "\n=== Mass cancel (" << NUM_ORDERS << " resting orders, " << NUM_OWNERS << " owners, "
+              << (churned ? "churned" : "fresh") << " pool) ===\n";
+
+    // the same book twice - one tagged with owners, which takes owner 1 out with mass_cancel, the
+    // other untagged, which takes the same orders out one cancel_order at a time
+    std::unique_ptr<OrderBook> books[2];
+    std::vector<uint64_t> owned; // owner 1's IDs, for the cancel_order loop
+    double insert_ns[2] = {};
+    for (int b = 0; b < 2; ++b) {
+        books[b] = std::make_unique<OrderBook>();
+        if (churned) {
+            std::vector<uint64_t> ids;
+            ids.reserve(NUM_ORDERS);
+            for (int i = 0; i < NUM_ORDERS; ++i) ids.push_back(books[b]->process_order(orders[i]).new_order_id);
+            std::mt19937 shuffle_gen(7); // the same shuffle for both books, so both pools end up alike
+            std::shuffle(ids.begin(), ids.end(), shuffle_gen);
+            for (uint64_t id : ids) books[b]->cancel_order(id);
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < NUM_ORDERS; ++i) {
+            const uint32_t owner = 1 + i % NUM_OWNERS;
+            if (b == 0) books[b]->process_order(orders[i], TimeInForce::GTC, 0, owner);
+            else        books[b]->process_order(orders[i]);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        insert_ns[b] = std::chrono::duration<double, std::nano>(end - start).count() / NUM_ORDERS;
+    }
+    // nothing crosses, so order i got ID i + 1 (after the churn's NUM_ORDERS, if there was one)
+    const uint64_t first_id = churned ? NUM_ORDERS + 1 : 1;
+    for (int i = 0; i < NUM_ORDERS; i += NUM_OWNERS) owned.push_back(first_id + static_cast<uint64_t>(i));
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  insert, no owner:          " << insert_ns[1] << " ns/order\n";
+    std::cout << "  insert, with owner:        " << insert_ns[0] << " ns/order (+" << insert_ns[0] - insert_ns[1]
+              << " ns for the owner list)\n";
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t mass = books[0]->mass_cancel(1).size();
+    auto end = std::chrono::high_resolution_clock::now();
+    const double mass_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  mass_cancel(owner):        " << mass_ns / 1e6 << " ms, " << mass << " cancelled ("
+              << mass_ns / mass << " ns/order)\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t cancelled = 0;
+    for (uint64_t id : owned) cancelled += books[1]->cancel_order(id);
+    end = std::chrono::high_resolution_clock::now();
+    const double loop_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  cancel_order loop instead: " << loop_ns / 1e6 << " ms, " << cancelled << " cancelled ("
+              << loop_ns / cancelled << " ns/order, x" << std::setprecision(2) << loop_ns / mass_ns << " the mass cancel)\n";
+    std::cout << std::setprecision(1);
+
+    // one side of another owner - its other side's list isn't walked at all
+    start = std::chrono::high_resolution_clock::now();
+    const size_t side = books[0]->mass_cancel(2, OrderSide::Buy).size();
+    end = std::chrono::high_resolution_clock::now();
+    const double side_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  mass_cancel(owner, side):  " << side_ns / 1e6 << " ms, " << side << " cancelled ("
+              << side_ns / side << " ns/order)\n";
+
+    // a price range - whole levels at a time, whoever owns them. both books have lost owner 1, so
+    // the second one can cancel the same orders one at a time
+    start = std::chrono::high_resolution_clock::now();
+    std::span<const uint64_t> in_range = books[0]->mass_cancel(OrderSide::Sell, 10001, 10200);
+    end = std::chrono::high_resolution_clock::now();
+    const double range_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  mass_cancel(side, range):  " << range_ns / 1e6 << " ms, " << in_range.size() << " cancelled over 200 levels ("
+              << range_ns / in_range.size() << " ns/order), best ask now " << books[0]->get_best_ask() << "\n";
+
+    owned.assign(in_range.begin(), in_range.end());
+    start = std::chrono::high_resolution_clock::now();
+    cancelled = 0;
+    for (uint64_t id : owned) cancelled += books[1]->cancel_order(id);
+    end = std::chrono::high_resolution_clock::now();
+    const double range_loop_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  cancel_order loop instead: " << range_loop_ns / 1e6 << " ms, " << cancelled << " cancelled ("
+              << range_loop_ns / cancelled << " ns/order, x" << std::setprecision(2) << range_loop_ns / range_ns
+              << " the mass cancel)\n";
+    std::cout.unsetf(std::ios::fixed);
 }
 
 int main() {
@@ -225,5 +1726,22 @@ int main() {
     general_test(order_book);
     std::cout << "Total trades recorded in history: " << order_book.get_trade_history().size() << "\n\n";
     run_performance_benchmark();
+    run_latency_breakdown();
+    run_multi_symbol_benchmark();
+    run_cross_thread_latency_benchmark();
+    run_top_of_book_benchmark();
+    run_decode_benchmark();
+    run_market_data_benchmark();
+    run_wide_book_fok_benchmark();
+    run_journal_benchmark();
+    run_modify_benchmark();
+    run_stop_benchmark();
+    run_iceberg_benchmark();
+    run_auction_benchmark();
+    run_snapshot_benchmark();
+    run_replay_benchmark();
+    run_expiry_benchmark();
+    run_mass_cancel_benchmark(false);
+    run_mass_cancel_benchmark(true);
     return 0;
 }
\ No newline at end of file